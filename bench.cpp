@@ -0,0 +1,398 @@
+/*
+Copyright 2020. Siwei Wang.
+
+Microbenchmarks comparing each utility against a hand-written loop.
+*/
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "containment.h"
+#include "enumerate.h"
+#include "io.h"
+#include "product.h"
+#include "range.h"
+#include "sequence.h"
+#include "small_vector.h"
+#include "zip.h"
+
+using std::string;
+using std::vector;
+
+// Element counts every benchmark is run at.
+const size_t kSizes[] = {size_t(1) << 10, size_t(1) << 16, size_t(1) << 20};
+
+/**
+ * Forces the compiler to materialize value, so that
+ * the work producing it cannot be optimized away.
+ */
+template <typename T>
+inline void keep(const T &value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+/**
+ * Returns the fastest time in nanoseconds for one call of fn. Calls
+ * are batched until a batch takes at least 20 milliseconds, and the
+ * best of three batches is taken to filter out noise.
+ */
+template <typename Function>
+double measure(Function fn) {
+  using clock = std::chrono::steady_clock;
+  const auto budget = std::chrono::milliseconds(20);
+  size_t calls = 1;
+  for (;; calls *= 2) {
+    const auto start = clock::now();
+    for (size_t i = 0; i < calls; ++i) fn();
+    if (clock::now() - start >= budget) break;
+  }
+  auto best = std::chrono::duration<double, std::nano>::max();
+  for (int round = 0; round < 3; ++round) {
+    const auto start = clock::now();
+    for (size_t i = 0; i < calls; ++i) fn();
+    best = std::min(best, std::chrono::duration<double, std::nano>(
+                              clock::now() - start));
+  }
+  return best.count() / static_cast<double>(calls);
+}
+
+/**
+ * Times a utility against the equivalent hand-written loop
+ * and prints both, along with their ratio.
+ */
+template <typename Utility, typename Loop>
+void compare(const char *name, const char *type, size_t size, Utility utility,
+             Loop loop) {
+  const auto utility_ns = measure(utility);
+  const auto loop_ns = measure(loop);
+  std::printf("%-22s %-9s %9zu %14.1f %14.1f %8.2f\n", name, type, size,
+              utility_ns, loop_ns, utility_ns / loop_ns);
+}
+
+template <typename T>
+vector<T> random_vector(size_t size) {
+  std::mt19937_64 engine(size);
+  vector<T> items(size);
+  for (auto &item : items) item = static_cast<T>(engine() % 1000);
+  return items;
+}
+
+template <typename T>
+void bench_containers(const char *type) {
+  for (auto size : kSizes) {
+    const auto a = random_vector<T>(size);
+    const auto b = random_vector<T>(size);
+    // Missing from the data, so every search scans all of it.
+    const auto absent = static_cast<T>(5000);
+
+    compare(
+        "contains", type, size, [&] { keep(contains(a, absent)); },
+        [&] {
+          bool found = false;
+          for (size_t i = 0; i < size && !found; ++i) {
+            found = std::equal_to<>()(a[i], absent);
+          }
+          keep(found);
+        });
+
+    compare(
+        "zip", type, size,
+        [&] {
+          T sum = 0;
+          for (auto [x, y] : zip(a, b)) sum += x * y;
+          keep(sum);
+        },
+        [&] {
+          T sum = 0;
+          for (size_t i = 0; i < size; ++i) sum += a[i] * b[i];
+          keep(sum);
+        });
+
+    compare(
+        "enumerate", type, size,
+        [&] {
+          T sum = 0;
+          for (auto [i, x] : enumerate(a)) sum += static_cast<T>(i) * x;
+          keep(sum);
+        },
+        [&] {
+          T sum = 0;
+          for (size_t i = 0; i < size; ++i) sum += static_cast<T>(i) * a[i];
+          keep(sum);
+        });
+
+    // Square root of size per side, so the pair count matches.
+    const auto side = static_cast<size_t>(std::sqrt(static_cast<double>(size)));
+    const vector<T> c(a.begin(), a.begin() + static_cast<ptrdiff_t>(side));
+    const vector<T> d(b.begin(), b.begin() + static_cast<ptrdiff_t>(side));
+    compare(
+        "product", type, side * side,
+        [&] {
+          T sum = 0;
+          for (auto [x, y] : product(c, d)) sum += x * y;
+          keep(sum);
+        },
+        [&] {
+          T sum = 0;
+          for (size_t i = 0; i < side; ++i) {
+            for (size_t j = 0; j < side; ++j) sum += c[i] * d[j];
+          }
+          keep(sum);
+        });
+
+    compare(
+        "slice step 2", type, size,
+        [&] { keep(slice(a, std::nullopt, std::nullopt, 2)); },
+        [&] {
+          vector<T> result;
+          result.reserve((size + 1) / 2);
+          for (size_t i = 0; i < size; i += 2) result.push_back(a[i]);
+          keep(result);
+        });
+  }
+}
+
+void bench_range() {
+  for (auto size : kSizes) {
+    const auto stop = static_cast<int64_t>(size);
+    compare(
+        "range", "int64", size,
+        [&] {
+          int64_t sum = 0;
+          for (auto i : range(stop)) sum += i * i;
+          keep(sum);
+        },
+        [&] {
+          int64_t sum = 0;
+          for (int64_t i = 0; i < stop; ++i) sum += i * i;
+          keep(sum);
+        });
+
+    compare(
+        "range step 3", "int64", size,
+        [&] {
+          int64_t sum = 0;
+          for (auto i : range(int64_t(0), stop, 3)) sum += i * i;
+          keep(sum);
+        },
+        [&] {
+          int64_t sum = 0;
+          for (int64_t i = 0; i < stop; i += 3) sum += i * i;
+          keep(sum);
+        });
+  }
+}
+
+/**
+ * Comma separated words of random length, about size bytes long.
+ */
+string random_text(size_t size, char sep) {
+  std::mt19937 engine(static_cast<unsigned>(size));
+  string text;
+  text.reserve(size + 16);
+  while (text.size() < size) {
+    text.append(1 + engine() % 12, static_cast<char>('a' + engine() % 26));
+    text += sep;
+  }
+  return text;
+}
+
+void bench_strings() {
+  for (auto size : kSizes) {
+    const auto text = random_text(size, ',');
+
+    compare(
+        "split", "char", size, [&] { keep(split(text, ',')); },
+        [&] {
+          vector<string> tokens;
+          for (size_t first = 0; first < text.size();) {
+            auto last = text.find(',', first);
+            if (last == string::npos) last = text.size();
+            if (last != first) tokens.emplace_back(text, first, last - first);
+            first = last + 1;
+          }
+          keep(tokens);
+        });
+
+    compare(
+        "split_view", "char", size, [&] { keep(split_view(text, ',')); },
+        [&] {
+          vector<std::string_view> tokens;
+          const std::string_view view(text);
+          for (size_t first = 0; first < view.size();) {
+            auto last = view.find(',', first);
+            if (last == string::npos) last = view.size();
+            if (last != first) {
+              tokens.push_back(view.substr(first, last - first));
+            }
+            first = last + 1;
+          }
+          keep(tokens);
+        });
+
+    vector<std::string_view> reused;
+    compare(
+        "split_into", "char", size,
+        [&] {
+          split_into(text, ',', reused);
+          keep(reused);
+        },
+        [&] {
+          reused.clear();
+          const std::string_view view(text);
+          for (size_t first = 0; first < view.size();) {
+            auto last = view.find(',', first);
+            if (last == string::npos) last = view.size();
+            if (last != first) {
+              reused.push_back(view.substr(first, last - first));
+            }
+            first = last + 1;
+          }
+          keep(reused);
+        });
+
+    const string multi = random_text(size, ';');
+    compare(
+        "split multi-char", "char", size,
+        [&] { keep(split(multi, string("a;"))); },
+        [&] {
+          vector<string> tokens;
+          for (size_t first = 0; first < multi.size();) {
+            auto last = multi.find("a;", first);
+            if (last == string::npos) last = multi.size();
+            if (last != first) tokens.emplace_back(multi, first, last - first);
+            first = last + 2;
+          }
+          keep(tokens);
+        });
+
+    const auto tokens = split(text, ',');
+    compare(
+        "join", "string", tokens.size(),
+        [&] { keep(join(tokens.begin(), tokens.end(), ", ")); },
+        [&] {
+          string value = tokens.front();
+          for (size_t i = 1; i < tokens.size(); ++i) {
+            value += ", ";
+            value += tokens[i];
+          }
+          keep(value);
+        });
+  }
+
+  // A record with a dozen fields, which fits in the inline tokens.
+  const string record = "3,id,Quinn,42,x,7.5,b,ok,12,c,-1,end";
+  compare(
+      "split<16>", "char", record.size(),
+      [&] { keep(split<16>(record, ',')); },
+      [&] {
+        vector<string> fields;
+        for (size_t first = 0; first < record.size();) {
+          auto last = record.find(',', first);
+          if (last == string::npos) last = record.size();
+          if (last != first) fields.emplace_back(record, first, last - first);
+          first = last + 1;
+        }
+        keep(fields);
+      });
+}
+
+void bench_wc() {
+  char path[] = "/tmp/bench_wc_XXXXXX";
+  const auto fd = ::mkstemp(path);
+  if (fd < 0) return;
+  const auto text = random_text(size_t(1) << 24, ' ');
+  string lines = text;
+  for (size_t i = 80; i < lines.size(); i += 80) lines[i] = '\n';
+  if (::write(fd, lines.data(), lines.size()) !=
+      static_cast<ssize_t>(lines.size())) {
+    ::close(fd);
+    ::unlink(path);
+    return;
+  }
+  ::close(fd);
+
+  const mapped_file file(path);
+  compare(
+      "wc lines", "mapped", file.size(), [&] { keep(wc<line>(file)); },
+      [&] { keep(std::count(file.begin(), file.end(), '\n')); });
+  compare(
+      "wc words", "mapped", file.size(), [&] { keep(wc<string>(file)); },
+      [&] {
+        size_t words = 0;
+        bool after_space = true;
+        for (auto c : file) {
+          const bool space = c == ' ' || c == '\n';
+          words += after_space && !space;
+          after_space = space;
+        }
+        keep(words);
+      });
+  compare(
+      "wc all", "mapped", file.size(), [&] { keep(wc_all(file)); },
+      [&] {
+        keep(wc<line>(file));
+        keep(wc<string>(file));
+        keep(wc<char>(file));
+      });
+  compare(
+      "wc utf8 chars", "mapped", file.size(),
+      [&] { keep(wc<utf8_char>(file)); },
+      [&] {
+        // Counts lead bytes without checking that the text is valid.
+        size_t chars = 0;
+        for (auto c : file) chars += (static_cast<unsigned char>(c) >> 6) != 2;
+        keep(chars);
+      });
+  compare(
+      "wc utf8 words", "mapped", file.size(),
+      [&] { keep(wc<utf8_word>(file)); },
+      [&] {
+        // Decodes without checking that the text is valid.
+        size_t words = 0;
+        bool after_space = true;
+        for (auto first = file.begin(); first != file.end();) {
+          const auto lead = static_cast<unsigned char>(*first++);
+          char32_t code = lead;
+          if (lead >= 0xC0) {
+            const int extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : 1;
+            code &= 0x3Fu >> extra;
+            for (int i = 0; i < extra && first != file.end(); ++i) {
+              code = code << 6 | (static_cast<unsigned char>(*first++) & 0x3F);
+            }
+          }
+          const bool space =
+              code == ' ' || (code - '\t' <= '\r' - '\t') || code == 0x85 ||
+              code == 0xA0 || code == 0x1680 ||
+              (0x2000 <= code && code <= 0x200A) || code == 0x2028 ||
+              code == 0x2029 || code == 0x202F || code == 0x205F ||
+              code == 0x3000;
+          words += after_space && !space;
+          after_space = space;
+        }
+        keep(words);
+      });
+  ::unlink(path);
+}
+
+int main() {
+  std::printf("%-22s %-9s %9s %14s %14s %8s\n", "benchmark", "type", "size",
+              "utility (ns)", "loop (ns)", "ratio");
+  bench_containers<int32_t>("int32");
+  bench_containers<uint64_t>("uint64");
+  bench_containers<float>("float");
+  bench_containers<double>("double");
+  bench_range();
+  bench_strings();
+  bench_wc();
+}
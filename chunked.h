@@ -0,0 +1,655 @@
+/*
+Copyright 2020. Siwei Wang.
+
+Iteration over contiguous containers in fixed size blocks.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "zip.h"
+
+/**
+ * Non-owning view of a contiguous block of items, like std::span.
+ * Views of const items are read-only.
+ */
+template <typename T>
+class array_view {
+ private:
+  T *m_data;
+  size_t m_size;
+
+ public:
+  using value_type = std::remove_cv_t<T>;
+  using iterator = T *;
+
+  array_view() = delete;
+
+  /**
+   * A view of [data, data + size).
+   */
+  constexpr array_view(T *, size_t);
+
+  // Iteration over the items.
+
+  constexpr T *begin() const;
+  constexpr T *end() const;
+
+  /**
+   * Pointer to the first item.
+   */
+  constexpr T *data() const;
+
+  /**
+   * The number of items in the view.
+   */
+  constexpr size_t size() const;
+
+  /**
+   * The item at the given position. REQUIRES: index < size().
+   */
+  constexpr T &operator[](size_t) const;
+};
+
+namespace detail {
+
+/**
+ * Type of the items stored contiguously by C, const if C is.
+ */
+template <typename C>
+using contiguous_item =
+    std::remove_pointer_t<decltype(std::data(std::declval<C &>()))>;
+
+/**
+ * A block from one container is an array_view. Blocks from several
+ * containers are bundled like the items of a zip.
+ */
+template <typename... Ts>
+struct chunk_bundle {
+  using type = typename zip_bundle<array_view<Ts>...>::type;
+};
+
+template <typename T>
+struct chunk_bundle<T> {
+  using type = array_view<T>;
+};
+
+}  // namespace detail
+
+/**
+ * Templated class for iteration over contiguous containers in blocks
+ * of a given size. Each block views the next size items of every
+ * container, and the last block may be shorter. Loops over a block
+ * index raw arrays, which the compiler can vectorize. Several
+ * containers are traversed in parallel, stopping with the shortest.
+ * REQUIRES: Ts are the items of contiguous containers, such as
+ * std::vector, std::array or std::string, that outlive the view.
+ * THROWS: std::out_of_range if size is zero.
+ */
+template <typename... Ts>
+class chunked_view {
+  static_assert(sizeof...(Ts) > 0, "Chunks need at least one container.");
+
+ private:
+  std::tuple<Ts *...> m_data;
+  const size_t m_size;
+  const size_t m_chunk;
+
+ public:
+  chunked_view() = delete;
+
+  /**
+   * Chunked view should be passed the block size, the number of items
+   * shared by every container, and the first item of each.
+   */
+  chunked_view(size_t chunk, size_t size, Ts *...);
+
+  // Declare random access iterators.
+  class iterator {
+    friend class chunked_view;
+
+   private:
+    const chunked_view *m_parent;
+
+    /**
+     * Position of the current block.
+     */
+    ptrdiff_t m_block;
+
+    /**
+     * Constructor that gives parameters.
+     */
+    iterator(const chunked_view *, ptrdiff_t);
+
+    template <size_t... I>
+    auto dereference(std::index_sequence<I...>) const;
+
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = typename detail::chunk_bundle<Ts...>::type;
+    using difference_type = ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    iterator() = delete;
+
+    /**
+     * Position of the first item of the current block.
+     */
+    size_t offset() const;
+
+    // Increment operator.
+
+    iterator &operator++();
+    iterator operator++(int);
+
+    // Decrement operator.
+
+    iterator &operator--();
+    iterator operator--(int);
+
+    // Random access operators.
+
+    iterator &operator+=(ptrdiff_t);
+    iterator &operator-=(ptrdiff_t);
+    iterator operator+(ptrdiff_t) const;
+    iterator operator-(ptrdiff_t) const;
+    ptrdiff_t operator-(const iterator &) const;
+    reference operator[](ptrdiff_t) const;
+
+    friend iterator operator+(ptrdiff_t n, const iterator &it) {
+      return it + n;
+    }
+
+    // Dereference operator. Blocks are views, so they are made on demand.
+
+    reference operator*() const;
+
+    // These iterators do not support arrow operators.
+
+    // Comparison operators.
+
+    bool operator==(const iterator &) const;
+    bool operator!=(const iterator &) const;
+    bool operator<(const iterator &) const;
+    bool operator>(const iterator &) const;
+    bool operator<=(const iterator &) const;
+    bool operator>=(const iterator &) const;
+  };
+
+  /**
+   * An iterator to the first block.
+   */
+  iterator begin() const;
+
+  /**
+   * An iterator to one past the last block.
+   */
+  iterator end() const;
+
+  /**
+   * The number of blocks.
+   */
+  size_t size() const;
+};
+
+/**
+ * Templated class for enumerated iteration in blocks. Dereferencing
+ * yields the index of the first item of the block, counted from start,
+ * paired with a view of the block.
+ * REQUIRES: C is contiguous and outlives the view.
+ * THROWS: std::out_of_range if size is zero.
+ */
+template <typename T>
+class chunked_enumerate {
+ private:
+  const chunked_view<T> m_chunks;
+  const size_t m_start;
+
+ public:
+  chunked_enumerate() = delete;
+
+  /**
+   * Should be passed the container, the block size and the start index.
+   */
+  template <typename C>
+  chunked_enumerate(C &, size_t, size_t = 0);
+
+  // Declare random access iterators.
+  class iterator {
+    friend class chunked_enumerate;
+
+   private:
+    typename chunked_view<T>::iterator m_iter;
+    size_t m_start;
+
+    /**
+     * Constructor that gives parameters.
+     */
+    iterator(typename chunked_view<T>::iterator, size_t);
+
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::pair<size_t, array_view<T>>;
+    using difference_type = ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    iterator() = delete;
+
+    // Increment operator.
+
+    iterator &operator++();
+    iterator operator++(int);
+
+    // Decrement operator.
+
+    iterator &operator--();
+    iterator operator--(int);
+
+    // Random access operators.
+
+    iterator &operator+=(ptrdiff_t);
+    iterator &operator-=(ptrdiff_t);
+    iterator operator+(ptrdiff_t) const;
+    iterator operator-(ptrdiff_t) const;
+    ptrdiff_t operator-(const iterator &) const;
+    reference operator[](ptrdiff_t) const;
+
+    friend iterator operator+(ptrdiff_t n, const iterator &it) {
+      return it + n;
+    }
+
+    // Dereference operator.
+
+    reference operator*() const;
+
+    // These iterators do not support arrow operators.
+
+    // Comparison operators.
+
+    bool operator==(const iterator &) const;
+    bool operator!=(const iterator &) const;
+    bool operator<(const iterator &) const;
+    bool operator>(const iterator &) const;
+    bool operator<=(const iterator &) const;
+    bool operator>=(const iterator &) const;
+  };
+
+  /**
+   * An iterator to the first block.
+   */
+  iterator begin() const;
+
+  /**
+   * An iterator to one past the last block.
+   */
+  iterator end() const;
+
+  /**
+   * The number of blocks.
+   */
+  size_t size() const;
+};
+
+template <typename C>
+chunked_enumerate(C &, size_t, size_t = 0)
+    -> chunked_enumerate<detail::contiguous_item<C>>;
+
+/**
+ * Blocks of size items of a contiguous container, as array_views.
+ */
+template <typename C>
+chunked_view<detail::contiguous_item<C>> chunked(C &items, size_t size) {
+  return chunked_view<detail::contiguous_item<C>>(size, std::size(items),
+                                                  std::data(items));
+}
+
+/**
+ * Blocks of size items of several contiguous containers in parallel,
+ * bundled like the items of a zip. Stops with the shortest container.
+ */
+template <typename... Cs>
+chunked_view<detail::contiguous_item<Cs>...> chunked_zip(size_t size,
+                                                         Cs &... items) {
+  const auto shortest = std::min({static_cast<size_t>(std::size(items))...});
+  return chunked_view<detail::contiguous_item<Cs>...>(size, shortest,
+                                                      std::data(items)...);
+}
+
+/* --- TEMPLATE IMPLEMENTATION --- */
+
+template <typename T>
+constexpr array_view<T>::array_view(T *data_in, size_t size_in)
+    : m_data(data_in), m_size(size_in) {}
+
+template <typename T>
+constexpr T *array_view<T>::begin() const {
+  return m_data;
+}
+
+template <typename T>
+constexpr T *array_view<T>::end() const {
+  return m_data + m_size;
+}
+
+template <typename T>
+constexpr T *array_view<T>::data() const {
+  return m_data;
+}
+
+template <typename T>
+constexpr size_t array_view<T>::size() const {
+  return m_size;
+}
+
+template <typename T>
+constexpr T &array_view<T>::operator[](size_t index) const {
+  return m_data[index];
+}
+
+template <typename... Ts>
+inline chunked_view<Ts...>::chunked_view(size_t chunk, size_t size,
+                                         Ts *... data)
+    : m_data(data...), m_size(size), m_chunk(chunk) {
+  if (chunk == 0) throw std::out_of_range("Chunk size must be non-zero.");
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator chunked_view<Ts...>::begin()
+    const {
+  return iterator(this, 0);
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator chunked_view<Ts...>::end()
+    const {
+  return iterator(this, static_cast<ptrdiff_t>(size()));
+}
+
+template <typename... Ts>
+inline size_t chunked_view<Ts...>::size() const {
+  return (m_size + m_chunk - 1) / m_chunk;
+}
+
+template <typename... Ts>
+inline chunked_view<Ts...>::iterator::iterator(const chunked_view *parent,
+                                               ptrdiff_t block)
+    : m_parent(parent), m_block(block) {}
+
+template <typename... Ts>
+inline size_t chunked_view<Ts...>::iterator::offset() const {
+  return static_cast<size_t>(m_block) * m_parent->m_chunk;
+}
+
+template <typename... Ts>
+template <size_t... I>
+inline auto chunked_view<Ts...>::iterator::dereference(
+    std::index_sequence<I...>) const {
+  const auto first = offset();
+  const auto length = std::min(m_parent->m_chunk, m_parent->m_size - first);
+  if constexpr (sizeof...(Ts) == 1) {
+    return reference(std::get<0>(m_parent->m_data) + first, length);
+  } else {
+    return reference(
+        array_view<Ts>(std::get<I>(m_parent->m_data) + first, length)...);
+  }
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator &
+chunked_view<Ts...>::iterator::operator++() {
+  ++m_block;
+  return *this;
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator
+chunked_view<Ts...>::iterator::operator++(int) {
+  auto temp(*this);
+  ++m_block;
+  return temp;
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator &
+chunked_view<Ts...>::iterator::operator--() {
+  --m_block;
+  return *this;
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator
+chunked_view<Ts...>::iterator::operator--(int) {
+  auto temp(*this);
+  --m_block;
+  return temp;
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator &
+chunked_view<Ts...>::iterator::operator+=(ptrdiff_t n) {
+  m_block += n;
+  return *this;
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator &
+chunked_view<Ts...>::iterator::operator-=(ptrdiff_t n) {
+  m_block -= n;
+  return *this;
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator
+chunked_view<Ts...>::iterator::operator+(ptrdiff_t n) const {
+  auto temp(*this);
+  return temp += n;
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator
+chunked_view<Ts...>::iterator::operator-(ptrdiff_t n) const {
+  auto temp(*this);
+  return temp -= n;
+}
+
+template <typename... Ts>
+inline ptrdiff_t chunked_view<Ts...>::iterator::operator-(
+    const iterator &other) const {
+  return m_block - other.m_block;
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator::reference
+    chunked_view<Ts...>::iterator::operator[](ptrdiff_t n) const {
+  return *(*this + n);
+}
+
+template <typename... Ts>
+inline typename chunked_view<Ts...>::iterator::reference
+    chunked_view<Ts...>::iterator::operator*() const {
+  return dereference(std::index_sequence_for<Ts...>());
+}
+
+template <typename... Ts>
+inline bool chunked_view<Ts...>::iterator::operator==(
+    const iterator &other) const {
+  return m_block == other.m_block;
+}
+
+template <typename... Ts>
+inline bool chunked_view<Ts...>::iterator::operator!=(
+    const iterator &other) const {
+  return m_block != other.m_block;
+}
+
+template <typename... Ts>
+inline bool chunked_view<Ts...>::iterator::operator<(
+    const iterator &other) const {
+  return m_block < other.m_block;
+}
+
+template <typename... Ts>
+inline bool chunked_view<Ts...>::iterator::operator>(
+    const iterator &other) const {
+  return other < *this;
+}
+
+template <typename... Ts>
+inline bool chunked_view<Ts...>::iterator::operator<=(
+    const iterator &other) const {
+  return !(other < *this);
+}
+
+template <typename... Ts>
+inline bool chunked_view<Ts...>::iterator::operator>=(
+    const iterator &other) const {
+  return !(*this < other);
+}
+
+template <typename T>
+template <typename C>
+inline chunked_enumerate<T>::chunked_enumerate(C &items, size_t size,
+                                               size_t start)
+    : m_chunks(chunked(items, size)), m_start(start) {}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator chunked_enumerate<T>::begin()
+    const {
+  return iterator(m_chunks.begin(), m_start);
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator chunked_enumerate<T>::end()
+    const {
+  return iterator(m_chunks.end(), m_start);
+}
+
+template <typename T>
+inline size_t chunked_enumerate<T>::size() const {
+  return m_chunks.size();
+}
+
+template <typename T>
+inline chunked_enumerate<T>::iterator::iterator(
+    typename chunked_view<T>::iterator iter, size_t start)
+    : m_iter(iter), m_start(start) {}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator &
+chunked_enumerate<T>::iterator::operator++() {
+  ++m_iter;
+  return *this;
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator
+chunked_enumerate<T>::iterator::operator++(int) {
+  auto temp(*this);
+  ++m_iter;
+  return temp;
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator &
+chunked_enumerate<T>::iterator::operator--() {
+  --m_iter;
+  return *this;
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator
+chunked_enumerate<T>::iterator::operator--(int) {
+  auto temp(*this);
+  --m_iter;
+  return temp;
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator &
+chunked_enumerate<T>::iterator::operator+=(ptrdiff_t n) {
+  m_iter += n;
+  return *this;
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator &
+chunked_enumerate<T>::iterator::operator-=(ptrdiff_t n) {
+  m_iter -= n;
+  return *this;
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator
+chunked_enumerate<T>::iterator::operator+(ptrdiff_t n) const {
+  auto temp(*this);
+  return temp += n;
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator
+chunked_enumerate<T>::iterator::operator-(ptrdiff_t n) const {
+  auto temp(*this);
+  return temp -= n;
+}
+
+template <typename T>
+inline ptrdiff_t chunked_enumerate<T>::iterator::operator-(
+    const iterator &other) const {
+  return m_iter - other.m_iter;
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator::reference
+    chunked_enumerate<T>::iterator::operator[](ptrdiff_t n) const {
+  return *(*this + n);
+}
+
+template <typename T>
+inline typename chunked_enumerate<T>::iterator::reference
+    chunked_enumerate<T>::iterator::operator*() const {
+  return reference(m_start + m_iter.offset(), *m_iter);
+}
+
+template <typename T>
+inline bool chunked_enumerate<T>::iterator::operator==(
+    const iterator &other) const {
+  return m_iter == other.m_iter;
+}
+
+template <typename T>
+inline bool chunked_enumerate<T>::iterator::operator!=(
+    const iterator &other) const {
+  return m_iter != other.m_iter;
+}
+
+template <typename T>
+inline bool chunked_enumerate<T>::iterator::operator<(
+    const iterator &other) const {
+  return m_iter < other.m_iter;
+}
+
+template <typename T>
+inline bool chunked_enumerate<T>::iterator::operator>(
+    const iterator &other) const {
+  return other < *this;
+}
+
+template <typename T>
+inline bool chunked_enumerate<T>::iterator::operator<=(
+    const iterator &other) const {
+  return !(other < *this);
+}
+
+template <typename T>
+inline bool chunked_enumerate<T>::iterator::operator>=(
+    const iterator &other) const {
+  return !(*this < other);
+}
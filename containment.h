@@ -6,33 +6,123 @@ Containment checking for STL containers.
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
+#include <functional>
 #include <iterator>
-#include <set>
 #include <type_traits>
-#include <unordered_set>
+#include <utility>
+
+#include "scan.h"
+
+namespace detail {
+
+/**
+ * Whether Container has a find member that returns one of its own
+ * iterators, as every set and map does. This excludes std::string,
+ * whose find returns a position.
+ */
+template <typename Container, typename T, typename = void>
+struct has_find : std::false_type {};
+
+template <typename Container, typename T>
+struct has_find<
+    Container, T,
+    std::enable_if_t<std::is_same_v<
+        decltype(std::declval<const Container &>().find(std::declval<T>())),
+        typename Container::const_iterator>>> : std::true_type {};
 
 /**
- * REQUIRES: Container has non-associative STL container semantics.
- * Returns whether or not the value is contained within.
+ * Whether Container maps keys to values, as every map does.
+ */
+template <typename Container, typename = void>
+struct is_map : std::false_type {};
+
+template <typename Container>
+struct is_map<Container, std::void_t<typename Container::mapped_type>>
+    : std::true_type {};
+
+/**
+ * Whether Container stores integers or floats contiguously, as
+ * std::vector, std::array and std::string do, so that it can be
+ * searched with vector equality compares.
+ */
+template <typename Container, typename = void>
+struct is_scannable : std::false_type {};
+
+template <typename Container>
+struct is_scannable<
+    Container,
+    std::enable_if_t<std::is_same_v<
+        decltype(std::data(std::declval<const Container &>())),
+        const typename Container::value_type *>>>
+    : std::bool_constant<is_scannable_v<typename Container::value_type>> {};
+
+}  // namespace detail
+
+/**
+ * Returns whether or not the value is contained within. Containers
+ * with a find member, such as sets and maps with any comparator or
+ * hasher, are searched with it. Maps look up the key of the target
+ * pair, then compare the values. Contiguous integers and floats are
+ * scanned with SIMD. Everything else is searched linearly.
  */
 template <typename Container>
 inline bool contains(const Container &items,
                      const typename Container::value_type &target) {
-  using T = typename Container::value_type;
-  if constexpr (std::is_same_v<Container, std::unordered_set<T>> ||
-                std::is_same_v<Container, std::set<T>>) {
+  if constexpr (detail::is_map<Container>::value) {
+    const auto matches = items.equal_range(target.first);
+    return std::find(matches.first, matches.second, target) != matches.second;
+  } else if constexpr (detail::has_find<Container,
+                                        decltype(target)>::value) {
     return items.find(target) != items.end();
+  } else if constexpr (detail::is_scannable<Container>::value) {
+    const auto first = std::data(items);
+    const auto last = first + std::size(items);
+    return detail::find_value(first, last, target) != last;
   } else {
     return std::find(items.begin(), items.end(), target) != items.end();
   }
 }
 
+/**
+ * REQUIRES: items is sorted by comp.
+ * Returns whether or not the value is contained within,
+ * found by binary search.
+ */
+template <typename Container, typename T, typename Compare = std::less<>>
+inline bool contains_sorted(const Container &items, const T &target,
+                            Compare comp = Compare()) {
+  return std::binary_search(std::begin(items), std::end(items), target, comp);
+}
+
+/**
+ * REQUIRES: items is sorted by comp. Queries is random access.
+ * Returns whether or not every query is contained within. The queries
+ * are sorted and deduplicated, then merged with items in one pass.
+ */
+template <typename Container, typename Queries, typename Compare = std::less<>>
+inline bool contains_all(const Container &items, Queries queries,
+                         Compare comp = Compare()) {
+  std::sort(std::begin(queries), std::end(queries), comp);
+  // Sorted queries are equivalent exactly when neither precedes the other.
+  const auto unique_end = std::unique(
+      std::begin(queries), std::end(queries),
+      [&comp](const auto &a, const auto &b) { return !comp(a, b); });
+  return std::includes(std::begin(items), std::end(items), std::begin(queries),
+                       unique_end, comp);
+}
+
 /**
  * Specialized container checking for C-style arrays.
+ * Integers and floats are scanned with SIMD.
  */
 template <size_t N, typename T>
 inline bool contains(const T *const items, const T &target) {
-  return std::find(items, items + N, target) != std::next(items, N);
+  if constexpr (detail::is_scannable_v<T>) {
+    return detail::find_value(items, items + N, target) != items + N;
+  } else {
+    return std::find(items, items + N, target) != std::next(items, N);
+  }
 }
 
 /**
@@ -44,3 +134,110 @@ inline bool contains_key(const Container &items,
                          const typename Container::key_type &target) {
   return items.find(target) != items.end();
 }
+
+/**
+ * Immutable set of keys fixed at compile time, such as keywords or
+ * small primes. The keys are sorted while the set is constructed, so
+ * lookup is a branchless binary search of fixed depth that the
+ * compiler can fully unroll.
+ * REQUIRES: T is a literal type ordered by operator<.
+ */
+template <typename T, size_t N>
+class static_set {
+ private:
+  T m_items[N > 0 ? N : 1];
+
+ public:
+  using value_type = T;
+  using const_iterator = const T *;
+
+  static_set() = delete;
+
+  /**
+   * A set holding the given keys. Duplicates are allowed.
+   */
+  constexpr explicit static_set(const T (&)[N]);
+
+  /**
+   * Whether or not the key is contained within.
+   */
+  constexpr bool contains(const T &) const;
+
+  /**
+   * The keys, in sorted order.
+   */
+  constexpr const_iterator begin() const;
+  constexpr const_iterator end() const;
+
+  /**
+   * The number of keys in the set.
+   */
+  constexpr size_t size() const;
+};
+
+/**
+ * Creates a static_set from a braced list of keys, as in
+ * constexpr auto primes = make_static_set({2, 3, 5, 7});
+ */
+template <typename T, size_t N>
+constexpr static_set<T, N> make_static_set(const T (&items)[N]) {
+  return static_set<T, N>(items);
+}
+
+/**
+ * Returns whether or not the key is contained within the static_set.
+ * Usable in constant expressions.
+ */
+template <typename T, size_t N>
+constexpr bool contains(const static_set<T, N> &items,
+                        const typename static_set<T, N>::value_type &target) {
+  return items.contains(target);
+}
+
+/* --- TEMPLATE IMPLEMENTATION --- */
+
+template <typename T, size_t N>
+constexpr static_set<T, N>::static_set(const T (&items)[N]) : m_items{} {
+  // std::sort is not constexpr until C++20, so insertion sort the keys.
+  for (size_t i = 0; i < N; ++i) {
+    auto j = i;
+    for (; j > 0 && items[i] < m_items[j - 1]; --j) {
+      m_items[j] = m_items[j - 1];
+    }
+    m_items[j] = items[i];
+  }
+}
+
+template <typename T, size_t N>
+constexpr bool static_set<T, N>::contains(const T &target) const {
+  if constexpr (N == 0) {
+    return false;
+  } else {
+    // Narrow to the last key not greater than the target. The step is
+    // a select rather than a branch, and the trip count depends only on N.
+    const T *first = m_items;
+    for (auto length = N; length > 1;) {
+      const auto half = length / 2;
+      first += (target < first[half]) ? 0 : half;
+      length -= half;
+    }
+    return !(*first < target) && !(target < *first);
+  }
+}
+
+template <typename T, size_t N>
+constexpr typename static_set<T, N>::const_iterator static_set<T, N>::begin()
+    const {
+  return m_items;
+}
+
+template <typename T, size_t N>
+constexpr typename static_set<T, N>::const_iterator static_set<T, N>::end()
+    const {
+  return m_items + N;
+}
+
+template <typename T, size_t N>
+constexpr size_t static_set<T, N>::size() const {
+  return N;
+}
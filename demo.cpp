@@ -3,19 +3,30 @@ Copyright 2020. Siwei Wang.
 
 Demo functionality.
 */
+// Counts allocations when built with UTILITY_INSTRUMENTATION.
+#define UTILITY_INSTRUMENTATION_MAIN
+
+#include <atomic>
 #include <iostream>
+#include <memory_resource>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "chunked.h"
 #include "containment.h"
 #include "enumerate.h"
+#include "instrument.h"
 #include "io.h"
+#include "pipeline.h"
 #include "product.h"
 #include "range.h"
 #include "sequence.h"
+#include "small_vector.h"
 #include "zip.h"
 
 using std::cout;
@@ -25,26 +36,51 @@ using std::unordered_map;
 using std::unordered_set;
 using std::vector;
 
+void demo_chunked();
 void demo_contains();
 void demo_enumerate();
 void demo_io();
+void demo_pipeline();
 void demo_product();
 void demo_range();
 void demo_sequence();
 void demo_zip();
 
 int main() {
+  demo_chunked();
   demo_contains();
   demo_enumerate();
   demo_io();
+  demo_pipeline();
   demo_product();
   demo_range();
   demo_sequence();
   demo_zip();
+  if constexpr (instrumentation_enabled) {
+    cout << "\n--- INSTRUMENTATION ---\n" << instrumentation_snapshot();
+  }
+}
+
+void demo_chunked() {
+  cout << "--- CHUNKED DEMO ---\n";
+  vector<float> prices{1.5f, 2.f, 0.5f, 4.f, 3.f, 2.5f, 1.f};
+  const vector<float> counts{2.f, 1.f, 4.f, 1.f, 2.f, 2.f, 3.f};
+  for (auto block : chunked(prices, 3)) {
+    for (auto &price : block) price *= 2.f;
+  }
+  float total = 0.f;
+  for (auto [price, count] : chunked_zip(4, prices, counts)) {
+    for (size_t i = 0; i < price.size(); ++i) total += price[i] * count[i];
+  }
+  cout << "Total of doubled prices: " << total << '\n';
+  for (auto [first, block] : chunked_enumerate(counts, 3)) {
+    cout << "Block starting at " << first << ": ";
+    print_range(block.begin(), block.end());
+  }
 }
 
 void demo_contains() {
-  cout << "--- CONTAINMENT DEMO ---\n";
+  cout << "\n--- CONTAINMENT DEMO ---\n";
   const vector<int> squares{1, 4, 9, 16};
   if (contains(squares, 16)) {
     cout << "16 is a perfect square.\n";
@@ -55,6 +91,12 @@ void demo_contains() {
     cout << "11 is a prime number.\n";
   }
 
+  constexpr auto static_primes = make_static_set({13, 2, 11, 3, 7, 5});
+  static_assert(contains(static_primes, 7));
+  if (!contains(static_primes, 9)) {
+    cout << "9 is not a prime number, checked against a compile-time set.\n";
+  }
+
   const unordered_map<string, int> age{{"siwei", 21}, {"grace", 16}};
   if (contains_key(age, string("siwei"))) {
     cout << "siwei is a registered name.\n";
@@ -64,6 +106,14 @@ void demo_contains() {
   if (!contains(names, string("yolanda"))) {
     cout << "yolanda is not contained.\n";
   }
+
+  if (contains_sorted(squares, 9)) {
+    cout << "9 is found by binary search.\n";
+  }
+
+  if (contains_all(squares, vector<int>{16, 1, 4, 1})) {
+    cout << "1, 4 and 16 are all perfect squares.\n";
+  }
 }
 
 void demo_enumerate() {
@@ -80,6 +130,15 @@ void demo_enumerate() {
   cout << "\nRange of pairs, default start:\n\t";
   const auto indexed = enumerate(vec);
   print_range(indexed.begin(), indexed.end());
+
+  vector<int> squares(6);
+  for (auto [index, square] : enumerate(squares)) {
+    square = static_cast<int>(index * index);
+  }
+  const auto numbered = enumerate(squares);
+  cout << "Written through the enumeration:\n\t";
+  print_range(numbered.begin(), numbered.end());
+  cout << "Random access to the fourth entry: " << numbered.begin()[3] << '\n';
 }
 
 void demo_io() {
@@ -89,12 +148,71 @@ void demo_io() {
   const auto args = argparse<int>(argc, argv);
   cout << "Command line args: ";
   print_range(args.begin(), args.end(), ", ", " :)\n");
+  cout << "Command line args written to the file descriptor: " << std::flush;
+  print_range(args.begin(), args.end(), ", ", "\n", STDOUT_FILENO);
+  const auto few_args = argparse<int, 8>(argc, argv);
+  cout << "The same args, stored inline: ";
+  print_range(few_args.begin(), few_args.end(), ", ");
+
+  long total = 0;
+  for (auto token : split_range("3,1,4,1,5", ',')) total += *parse<long>(token);
+  cout << "Sum of parsed tokens in 3,1,4,1,5: " << total << '\n';
+  if (!parse<int>("12 monkeys")) cout << "12 monkeys is not a number.\n";
+  const char* loose[3] = {"demo", " 7 seas", "monkeys"};
+  const auto lenient = argparse<int>(3, loose);
+  cout << "Leniently parsed \" 7 seas\" and \"monkeys\": ";
+  print_range(lenient.begin(), lenient.end(), ", ");
+  try {
+    argparse_strict<int>(3, loose);
+  } catch (const std::invalid_argument& e) {
+    cout << "Strict parsing: " << e.what() << '\n';
+  }
 
   unordered_map<string, size_t> counter{{"characters", wc<char>("io.h")},
                                         {"words", wc<string>("io.h")},
                                         {"lines", wc<line>("io.h")}};
   cout << "Stats for io.h: ";
   print_range(counter.begin(), counter.end(), " -> ");
+  cout << "Lines in io.h counted in parallel: " << wc_parallel<line>("io.h", 4)
+       << '\n';
+  cout << "Code points and Unicode words in io.h: " << wc<utf8_char>("io.h")
+       << ", " << wc<utf8_word>("io.h") << '\n';
+  const auto all = wc_all("io.h");
+  cout << "Lines, words and bytes in io.h from one pass: " << all.lines << ' '
+       << all.words << ' ' << all.bytes << '\n';
+  prefetch_reader prefetched(string("io.h"), 4096);
+  size_t blocks = 0;
+  for (std::string_view block; prefetched.next(block);) ++blocks;
+  cout << "Blocks of io.h read ahead in the background: " << blocks << '\n';
+
+  std::istringstream table(
+      "name,quote\nsiwei,\"hello, world\"\ngrace,\"she said \"\"hi\"\"\"\n"
+      "ada,5\" tall\nalan,\"line\nbreak\"\n");
+  csv_reader reader(table);
+  vector<std::string_view> fields;
+  cout << "Fields of each CSV record:\n";
+  while (reader.next(fields)) {
+    cout << '\t';
+    print_range(fields.begin(), fields.end(), " | ");
+  }
+}
+
+void demo_pipeline() {
+  cout << "\n--- PIPELINE DEMO ---\n";
+  auto odd = [](int num) { return num % 2 == 1; };
+  auto square = [](int num) { return num * num; };
+  cout << "Batches of odd squares below 20:\n";
+  for (const auto &batch : range(20) | filter(odd) | map(square) | chunk(4)) {
+    cout << '\t';
+    print_range(batch.begin(), batch.end());
+  }
+
+  const vector<int> lengths{3, 1, 4, 1, 5, 9, 2, 6};
+  const vector<int> widths{2, 7, 1, 8, 2, 8, 1, 8};
+  auto area = [](auto dims) { return dims.first * dims.second; };
+  cout << "First three areas: ";
+  const auto areas = zip(lengths, widths) | map(area) | take(3);
+  print_range(areas.begin(), areas.end());
 }
 
 void demo_product() {
@@ -112,6 +230,17 @@ void demo_product() {
   cout << "Iterating over cartesian product: \"123\" x \"abc\".\n\t";
   const product prod(s2, s1);
   print_range(prod.begin(), prod.end());
+
+  const vector<int> rows{1, 2, 3, 4};
+  const vector<int> cols{10, 20, 30};
+  cout << "Visiting {1, 2, 3, 4} x {10, 20, 30} in 2 x 2 tiles.\n\t";
+  const product tiled(rows, cols, 2);
+  print_range(tiled.begin(), tiled.end());
+  cout << "The fifth pair in tiled order is " << tiled.begin()[4] << ".\n";
+
+  std::atomic<int> dot(0);
+  parallel_for_each(tiled, [&dot](auto pr) { dot += pr.first * pr.second; }, 4);
+  cout << "Sum of all pairwise products on 4 threads: " << dot << '\n';
 }
 
 void demo_range() {
@@ -124,7 +253,15 @@ void demo_range() {
   for (auto i : range(-5, 4)) cout << i << ' ';
   cout << "\nrange(4, -5): ";
   for (auto i : range(4, -5)) cout << i << ' ';
-  cout << '\n';
+  cout << "\nrange(20, 0, -3): ";
+  for (auto i : range(20, 0, -3)) cout << i << ' ';
+  cout << "\nrange<int, 4>(0, 18): ";
+  for (auto i : range<int, 4>(0, 18)) cout << i << ' ';
+  cout << "\nrange(0.0, 1.0, 0.1): ";
+  for (auto x : range(0.0, 1.0, 0.1)) cout << x << ' ';
+  const range big(0, 1'000'000'000);
+  cout << "\nrange(0, 1'000'000'000) has " << big.size()
+       << " items and item 123456789 is " << big[123'456'789] << '\n';
 }
 
 void demo_sequence() {
@@ -137,10 +274,18 @@ void demo_sequence() {
   cout << "\tnums[-1:2:-2]: ";
   print_range(sl1.begin(), sl1.end());
 
+  const auto sl0 = slice(nums, 0, 4);
+  cout << "\tnums[0:4]: ";
+  print_range(sl0.begin(), sl0.end());
+
   const auto sl2 = slice(nums, 3, 8, 2);
   cout << "\tnums[3:8:2]: ";
   print_range(sl2.begin(), sl2.end());
 
+  const slice_view evens(nums, std::nullopt, std::nullopt, 2);
+  cout << "\tnums[::2] as a view: ";
+  print_range(evens.begin(), evens.end());
+
   const string wd = "watch_dogs_2";
   cout << "Original string: " << wd << '\n';
   const auto tokens = split(wd, '_');
@@ -148,11 +293,47 @@ void demo_sequence() {
   print_range(tokens.begin(), tokens.end(), ", ");
   auto restored = join(tokens.begin(), tokens.end(), "**");
   cout << "After rejoining with double star: " << restored << '\n';
+  string record = "record: ";
+  join_into(tokens.begin(), tokens.end(), ',', record);
+  cout << "After appending to a buffer with commas: " << record << '\n';
   const string str_wd = "&*watch&*dogs&*2&*";
   const string delim = "&*";
   cout << "Splitting " << str_wd << " on &*: ";
   auto str_toks = split(str_wd, delim);
   print_range(str_toks.begin(), str_toks.end(), ", ");
+  const auto views = split_view(str_wd, delim);
+  cout << "Viewing the same tokens without copies: ";
+  print_range(views.begin(), views.end(), ", ");
+  const auto words =
+      split_words("na\u00efve\u3000caf\u00e9\u00a0cr\u00e8me br\u00fbl\u00e9e");
+  cout << "Splitting on Unicode whitespace: ";
+  print_range(words.begin(), words.end(), ", ");
+  cout << "Lazily splitting on underscore: ";
+  for (auto token : split_range(wd, '_')) cout << token << ' ';
+  cout << '\n';
+  vector<std::string_view> fields;
+  for (const auto *row : {"a,b,c", "d,e,f"}) {
+    split_into(row, ',', fields);  // Reuses the capacity of fields.
+    cout << "Refilled " << fields.size() << " fields: ";
+    print_range(fields.begin(), fields.end(), " ");
+  }
+  // Short results stay inside the small_vector rather than the heap.
+  const auto small_tokens = split<4>(wd, '_');
+  const auto small_slice = slice<4>(nums, 2, 6);
+  cout << "Splitting into inline storage: ";
+  print_range(small_tokens.begin(), small_tokens.end(), ", ");
+  cout << "\tnums[2:6] in inline storage: ";
+  print_range(small_slice.begin(), small_slice.end());
+
+  // Everything below comes from one arena, which is freed all at once.
+  std::pmr::monotonic_buffer_resource arena;
+  const auto arena_tokens = split(wd, '_', &arena);
+  const auto arena_joined =
+      join(arena_tokens.begin(), arena_tokens.end(), '-', &arena);
+  const auto arena_slice = slice_pmr(nums, &arena, 1, std::nullopt, 3);
+  cout << "Rejoined from an arena: " << arena_joined << '\n';
+  cout << "\tnums[1::3] from an arena: ";
+  print_range(arena_slice.begin(), arena_slice.end());
 }
 
 void demo_zip() {
@@ -172,4 +353,19 @@ void demo_zip() {
   cout << "\nLetters then numbers:\n";
   const auto join = zip(str, vec);
   print_range(join.begin(), join.end());
+
+  vector<int> counts{1, 2, 3};
+  vector<string> labels{"one", "two", "three"};
+  for (auto [count, label] : zip(counts, labels)) {
+    count *= 100;
+    label += '!';
+  }
+  cout << "Written through the zip:\n";
+  const auto written = zip(counts, labels);
+  print_range(written.begin(), written.end());
+
+  const vector<double> weights{0.5, 0.25, 0.125, 0.0625};
+  cout << "Zipping three columns:\n";
+  const auto columns = zip(counts, labels, weights);
+  print_range(columns.begin(), columns.end());
 }
@@ -5,45 +5,57 @@ Python-like enumerate for iteration with index.
 */
 #pragma once
 
+#include <cstddef>
 #include <iterator>
+#include <type_traits>
 #include <utility>
 
 /**
- * Templated enumerator class for read-only enumerated iteration.
+ * Templated enumerator class for enumerated iteration. Dereferencing
+ * yields the index paired with a reference into the container.
+ * Const containers are read-only, while non-const containers can be
+ * written through the enumeration. The iterator has the same category
+ * as the container's, so random access containers support indexing
+ * and the parallel algorithms.
  * REQUIRES: C is forward iterable.
  */
 template <typename C>
 class enumerate {
  private:
-  const C &container;
+  C &container;
   const size_t start;
 
+  using iter_type = decltype(std::begin(std::declval<C &>()));
+  using traits = std::iterator_traits<iter_type>;
+
  public:
   enumerate() = delete;
 
   /**
    * Enumerate object constructed with default index starting at 0.
    */
-  explicit enumerate(const C &, size_t = 0);
-
-  // Declare forward iterators.
-  class iterator : public std::iterator<
-                       std::forward_iterator_tag,
-                       std::pair<size_t, typename C::value_type>, ptrdiff_t,
-                       const std::pair<size_t, typename C::value_type> *,
-                       const std::pair<size_t, typename C::value_type> &> {
+  explicit enumerate(C &, size_t = 0);
+
+  // Declare iterators of the container's category.
+  class iterator {
     friend class enumerate;
 
    private:
-    typename C::const_iterator iter;
+    iter_type iter;
     size_t sz;
 
     /**
      * Constructor that gives parameters.
      */
-    explicit iterator(size_t, typename C::const_iterator);
+    explicit iterator(size_t, iter_type);
 
    public:
+    using iterator_category = typename traits::iterator_category;
+    using value_type = std::pair<size_t, typename traits::value_type>;
+    using difference_type = typename traits::difference_type;
+    using pointer = void;
+    using reference = std::pair<size_t, typename traits::reference>;
+
     iterator() = delete;
 
     // Increment operator.
@@ -51,16 +63,39 @@ class enumerate {
     iterator &operator++();
     iterator operator++(int);
 
+    // Decrement operator. REQUIRES: bidirectional container.
+
+    iterator &operator--();
+    iterator operator--(int);
+
+    // Random access operators. REQUIRES: random access container.
+
+    iterator &operator+=(difference_type);
+    iterator &operator-=(difference_type);
+    iterator operator+(difference_type) const;
+    iterator operator-(difference_type) const;
+    difference_type operator-(const iterator &) const;
+    reference operator[](difference_type) const;
+
+    friend iterator operator+(difference_type n, const iterator &it) {
+      return it + n;
+    }
+
     // Dereference operator.
 
-    std::pair<size_t, typename C::value_type> operator*() const;
+    reference operator*() const;
 
     // These iterators do not support arrow operators.
 
-    // Comparison operators.
+    // Comparison operators. The index moves in step with the
+    // container's iterator, so only the latter is compared.
 
     bool operator==(const iterator &) const;
     bool operator!=(const iterator &) const;
+    bool operator<(const iterator &) const;
+    bool operator>(const iterator &) const;
+    bool operator<=(const iterator &) const;
+    bool operator>=(const iterator &) const;
   };
 
   /**
@@ -77,22 +112,33 @@ class enumerate {
 /* --- TEMPLATE IMPLEMENTATION --- */
 
 template <typename C>
-inline enumerate<C>::enumerate(const C &items, size_t start_in)
+inline enumerate<C>::enumerate(C &items, size_t start_in)
     : container(items), start(start_in) {}
 
 template <typename C>
 inline typename enumerate<C>::iterator enumerate<C>::begin() const {
-  return iterator(start, container.cbegin());
+  return iterator(start, std::begin(container));
 }
 
 template <typename C>
 inline typename enumerate<C>::iterator enumerate<C>::end() const {
-  return iterator(start + container.size(), container.cend());
+  using category = typename traits::iterator_category;
+  const auto first = std::begin(container);
+  const auto last = std::end(container);
+  // The end index is only observable by stepping backward from it.
+  if constexpr (std::is_base_of_v<std::random_access_iterator_tag,
+                                  category>) {
+    return iterator(start + static_cast<size_t>(last - first), last);
+  } else if constexpr (std::is_base_of_v<std::bidirectional_iterator_tag,
+                                         category>) {
+    return iterator(start + std::size(container), last);
+  } else {
+    return iterator(start, last);
+  }
 }
 
 template <typename C>
-inline enumerate<C>::iterator::iterator(size_t sz_in,
-                                        typename C::const_iterator iter_in)
+inline enumerate<C>::iterator::iterator(size_t sz_in, iter_type iter_in)
     : iter(iter_in), sz(sz_in) {}
 
 template <typename C>
@@ -111,19 +157,99 @@ inline typename enumerate<C>::iterator enumerate<C>::iterator::operator++(int) {
 }
 
 template <typename C>
-inline std::pair<size_t, typename C::value_type> enumerate<C>::iterator::
+inline typename enumerate<C>::iterator &enumerate<C>::iterator::operator--() {
+  --iter;
+  --sz;
+  return *this;
+}
+
+template <typename C>
+inline typename enumerate<C>::iterator enumerate<C>::iterator::operator--(int) {
+  auto temp(*this);
+  --iter;
+  --sz;
+  return temp;
+}
+
+template <typename C>
+inline typename enumerate<C>::iterator &enumerate<C>::iterator::operator+=(
+    difference_type n) {
+  iter += n;
+  sz += static_cast<size_t>(n);
+  return *this;
+}
+
+template <typename C>
+inline typename enumerate<C>::iterator &enumerate<C>::iterator::operator-=(
+    difference_type n) {
+  return this->operator+=(-n);
+}
+
+template <typename C>
+inline typename enumerate<C>::iterator enumerate<C>::iterator::operator+(
+    difference_type n) const {
+  auto temp(*this);
+  return temp += n;
+}
+
+template <typename C>
+inline typename enumerate<C>::iterator enumerate<C>::iterator::operator-(
+    difference_type n) const {
+  auto temp(*this);
+  return temp -= n;
+}
+
+template <typename C>
+inline typename enumerate<C>::iterator::difference_type
+enumerate<C>::iterator::operator-(
+    const typename enumerate<C>::iterator &other) const {
+  return iter - other.iter;
+}
+
+template <typename C>
+inline typename enumerate<C>::iterator::reference
+    enumerate<C>::iterator::operator[](difference_type n) const {
+  return *(*this + n);
+}
+
+template <typename C>
+inline typename enumerate<C>::iterator::reference enumerate<C>::iterator::
 operator*() const {
-  return std::make_pair(sz, *iter);
+  return reference(sz, *iter);
 }
 
 template <typename C>
 inline bool enumerate<C>::iterator::operator==(
     const typename enumerate<C>::iterator &other) const {
-  return iter == other.iter && sz == other.sz;
+  return iter == other.iter;
 }
 
 template <typename C>
 inline bool enumerate<C>::iterator::operator!=(
     const typename enumerate<C>::iterator &other) const {
-  return iter != other.iter || sz != other.sz;
+  return iter != other.iter;
+}
+
+template <typename C>
+inline bool enumerate<C>::iterator::operator<(
+    const typename enumerate<C>::iterator &other) const {
+  return iter < other.iter;
+}
+
+template <typename C>
+inline bool enumerate<C>::iterator::operator>(
+    const typename enumerate<C>::iterator &other) const {
+  return other < *this;
+}
+
+template <typename C>
+inline bool enumerate<C>::iterator::operator<=(
+    const typename enumerate<C>::iterator &other) const {
+  return !(other < *this);
+}
+
+template <typename C>
+inline bool enumerate<C>::iterator::operator>=(
+    const typename enumerate<C>::iterator &other) const {
+  return !(*this < other);
 }
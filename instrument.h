@@ -0,0 +1,267 @@
+/*
+Copyright 2020. Siwei Wang.
+
+Opt-in instrumentation of the hot paths of the library.
+*/
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/**
+ * The library calls that are instrumented.
+ */
+enum class instrumented : size_t { split, join, slice, wc, argparse };
+
+/**
+ * Totals recorded for one kind of call. Cycles are read from the time
+ * stamp counter on x86-64, and are nanoseconds elsewhere.
+ */
+struct instrument_counters {
+  uint64_t calls = 0;
+  uint64_t bytes = 0;
+  uint64_t allocations = 0;
+  uint64_t cycles = 0;
+};
+
+/**
+ * The totals of every kind of instrumented call at one moment.
+ */
+struct instrument_snapshot {
+  static constexpr size_t size = 5;
+
+  std::array<instrument_counters, size> counters;
+
+  /**
+   * The totals of one kind of call.
+   */
+  const instrument_counters &operator[](instrumented) const;
+};
+
+/**
+ * Whether the library was built with UTILITY_INSTRUMENTATION defined.
+ * Otherwise nothing is recorded and every total stays zero.
+ */
+constexpr bool instrumentation_enabled =
+#if defined(UTILITY_INSTRUMENTATION)
+    true;
+#else
+    false;
+#endif
+
+/**
+ * The name of a kind of call, as it is spelled in the library.
+ */
+const char *instrument_name(instrumented);
+
+/**
+ * Returns the totals recorded so far by every thread.
+ */
+instrument_snapshot instrumentation_snapshot();
+
+/**
+ * Sets every total back to zero.
+ */
+void reset_instrumentation();
+
+/**
+ * Prints one row of totals for each kind of call.
+ */
+std::ostream &operator<<(std::ostream &, const instrument_snapshot &);
+
+namespace detail {
+
+/**
+ * Running totals for one kind of call, shared by every thread.
+ */
+struct instrument_totals {
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> cycles{0};
+};
+
+inline std::array<instrument_totals, instrument_snapshot::size> &
+instrument_table() {
+  static std::array<instrument_totals, instrument_snapshot::size> table;
+  return table;
+}
+
+/**
+ * Heap allocations made by this thread. Only counted in the program
+ * that defines UTILITY_INSTRUMENTATION_MAIN, which replaces operator new.
+ */
+inline thread_local uint64_t thread_allocations = 0;
+
+inline uint64_t cycle_count() {
+#if defined(__GNUC__) && defined(__x86_64__)
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+#endif
+}
+
+/**
+ * Records one call for as long as it is in scope: its cycles, the
+ * allocations made meanwhile on this thread, and the bytes reported.
+ */
+class probe {
+ private:
+  instrument_totals &m_totals;
+  const uint64_t m_allocations;
+  uint64_t m_bytes = 0;
+  const uint64_t m_start;
+
+ public:
+  explicit probe(instrumented op)
+      : m_totals(instrument_table()[static_cast<size_t>(op)]),
+        m_allocations(thread_allocations),
+        m_start(cycle_count()) {}
+
+  probe(const probe &) = delete;
+  probe &operator=(const probe &) = delete;
+
+  ~probe() {
+    const auto cycles = cycle_count() - m_start;
+    m_totals.calls.fetch_add(1, std::memory_order_relaxed);
+    m_totals.bytes.fetch_add(m_bytes, std::memory_order_relaxed);
+    m_totals.allocations.fetch_add(thread_allocations - m_allocations,
+                                   std::memory_order_relaxed);
+    m_totals.cycles.fetch_add(cycles, std::memory_order_relaxed);
+  }
+
+  /**
+   * Adds to the bytes processed by this call.
+   */
+  void add_bytes(size_t bytes) { m_bytes += bytes; }
+};
+
+/**
+ * Stands in for probe when instrumentation is disabled. Every member
+ * is empty, so probes compile away entirely.
+ */
+class null_probe {
+ public:
+  explicit constexpr null_probe(instrumented) {}
+
+  constexpr void add_bytes(size_t) const {}
+};
+
+}  // namespace detail
+
+/**
+ * Declared at the top of each instrumented call. Every inline function
+ * that declares one changes with UTILITY_INSTRUMENTATION, so the macro
+ * must be set the same way in every translation unit of a program.
+ * Mixing the two violates the one definition rule, and neither the
+ * compiler nor the linker reports it. The probe is a local variable
+ * and does not appear in any mangled name.
+ */
+#if defined(UTILITY_INSTRUMENTATION)
+using instrument_probe = detail::probe;
+#else
+using instrument_probe = detail::null_probe;
+#endif
+
+/* --- TEMPLATE IMPLEMENTATION --- */
+
+inline const instrument_counters &instrument_snapshot::operator[](
+    instrumented op) const {
+  return counters[static_cast<size_t>(op)];
+}
+
+inline const char *instrument_name(instrumented op) {
+  switch (op) {
+    case instrumented::split:
+      return "split";
+    case instrumented::join:
+      return "join";
+    case instrumented::slice:
+      return "slice";
+    case instrumented::wc:
+      return "wc";
+    case instrumented::argparse:
+      return "argparse";
+  }
+  return "unknown";
+}
+
+inline instrument_snapshot instrumentation_snapshot() {
+  instrument_snapshot snapshot;
+  const auto &table = detail::instrument_table();
+  for (size_t i = 0; i < instrument_snapshot::size; ++i) {
+    auto &counters = snapshot.counters[i];
+    counters.calls = table[i].calls.load(std::memory_order_relaxed);
+    counters.bytes = table[i].bytes.load(std::memory_order_relaxed);
+    counters.allocations =
+        table[i].allocations.load(std::memory_order_relaxed);
+    counters.cycles = table[i].cycles.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+inline void reset_instrumentation() {
+  for (auto &totals : detail::instrument_table()) {
+    totals.calls.store(0, std::memory_order_relaxed);
+    totals.bytes.store(0, std::memory_order_relaxed);
+    totals.allocations.store(0, std::memory_order_relaxed);
+    totals.cycles.store(0, std::memory_order_relaxed);
+  }
+}
+
+inline std::ostream &operator<<(std::ostream &os,
+                                const instrument_snapshot &snapshot) {
+  os << std::left << std::setw(10) << "call" << std::right << std::setw(12)
+     << "calls" << std::setw(16) << "bytes" << std::setw(14) << "allocations"
+     << std::setw(18) << "cycles" << '\n';
+  for (size_t i = 0; i < instrument_snapshot::size; ++i) {
+    const auto &counters = snapshot.counters[i];
+    os << std::left << std::setw(10)
+       << instrument_name(static_cast<instrumented>(i)) << std::right
+       << std::setw(12) << counters.calls << std::setw(16) << counters.bytes
+       << std::setw(14) << counters.allocations << std::setw(18)
+       << counters.cycles << '\n';
+  }
+  return os;
+}
+
+/**
+ * Counting replacements of the global allocation functions. Define
+ * UTILITY_INSTRUMENTATION_MAIN in exactly one translation unit of the
+ * program to count allocations. The array and nothrow forms forward to
+ * these by default.
+ */
+#if defined(UTILITY_INSTRUMENTATION) && defined(UTILITY_INSTRUMENTATION_MAIN)
+
+void *operator new(size_t size) {
+  ++detail::thread_allocations;
+  if (const auto memory = std::malloc(size > 0 ? size : 1)) return memory;
+  throw std::bad_alloc();
+}
+
+// Kept out of line so that GCC does not pair the free with a new.
+__attribute__((noinline)) void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void *memory,
+                                               size_t) noexcept {
+  std::free(memory);
+}
+
+#endif
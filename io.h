@@ -5,33 +5,125 @@ Tools for input output.
 */
 #pragma once
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
 #include <fstream>
 #include <ios>
 #include <iostream>
 #include <iterator>
+#include <locale>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "instrument.h"
+#include "scan.h"
+#include "small_vector.h"
+
 /**
- * Parse command line arguments into a vector
- * of a given type. Attempts to perform conversion.
+ * Parse a number from the whole of text, without allocating or
+ * consulting the locale. Integers are decimal with an optional sign,
+ * floats are in fixed or scientific notation, and bools are one of
+ * "true", "false", "1" or "0". Returns std::errc::invalid_argument if
+ * text is not a number, or std::errc::result_out_of_range if it does
+ * not fit in T. On failure, value is left unchanged.
  */
-template <typename T = std::string>
-std::vector<T> argparse(int argc, const char **argv) {
+template <typename T>
+std::errc parse(std::string_view text, T &value) {
+  static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, char>);
+  if constexpr (std::is_same_v<T, bool>) {
+    if (text == "true" || text == "1") {
+      value = true;
+    } else if (text == "false" || text == "0") {
+      value = false;
+    } else {
+      return std::errc::invalid_argument;
+    }
+    return std::errc();
+  } else {
+    // from_chars rejects an explicit plus sign, unlike strtol.
+    if (text.size() > 1 && text.front() == '+' && text[1] != '-') {
+      text.remove_prefix(1);
+    }
+    const auto last = text.data() + text.size();
+    T result;
+    std::from_chars_result status;
+    if constexpr (std::is_floating_point_v<T>) {
+      status = std::from_chars(text.data(), last, result);
+    } else {
+      status = std::from_chars(text.data(), last, result, 10);
+    }
+    if (status.ec != std::errc()) return status.ec;
+    if (status.ptr != last) return std::errc::invalid_argument;
+    value = result;
+    return std::errc();
+  }
+}
+
+/**
+ * Parse a number from the whole of text, as above.
+ * Returns std::nullopt if text is not a number that fits in T.
+ */
+template <typename T>
+std::optional<T> parse(std::string_view text) {
+  T value;
+  if (parse(text, value) != std::errc()) return std::nullopt;
+  return value;
+}
+
+namespace detail {
+
+/**
+ * Parse command line arguments into a list of the given type, holding
+ * strings or numbers. Strict lists convert numbers with parse, and the
+ * rest with strtold, strtoll or strtoull, which read a leading number
+ * and yield 0 when there is none.
+ * THROWS: std::invalid_argument if Strict and an argument is not a
+ * valid number.
+ */
+template <typename Items, bool Strict>
+Items parse_arguments(int argc, const char **argv) {
+  using T = typename Items::value_type;
   // Get some qualifications out of the way.
   static_assert(!std::is_const_v<T>);
   static_assert(!std::is_pointer_v<T> && !std::is_reference_v<T>);
   static_assert(!std::is_same_v<T, char>);
   static_assert(std::is_same_v<T, std::string> || std::is_arithmetic_v<T>);
-  // Prepare and reserve a vector to store items.
-  std::vector<T> items;
-  items.reserve(argc - 1);
+  instrument_probe probe(instrumented::argparse);
+  // Prepare and reserve a list to store items.
+  Items items;
+  items.reserve(static_cast<size_t>(argc > 1 ? argc - 1 : 0));
   // The type is either a string or a numerical type.
   for (int i = 1; i < argc; ++i) {
+    probe.add_bytes(std::char_traits<char>::length(argv[i]));
     if constexpr (std::is_same_v<T, std::string>) {
       items.emplace_back(argv[i]);
+    } else if constexpr (Strict) {
+      T value;
+      if (parse(argv[i], value) != std::errc()) {
+        throw std::invalid_argument("Could not parse argument " +
+                                    std::string(argv[i]));
+      }
+      items.emplace_back(value);
     } else if constexpr (std::is_floating_point_v<T>) {
       items.emplace_back(static_cast<T>(std::strtold(argv[i], nullptr)));
     } else if constexpr (std::is_signed_v<T>) {
@@ -43,6 +135,48 @@ std::vector<T> argparse(int argc, const char **argv) {
   return items;
 }
 
+}  // namespace detail
+
+/**
+ * Parse command line arguments into a vector of a given type. Like
+ * strtol, numbers may have leading whitespace or trailing text, and an
+ * argument that is not a number becomes 0.
+ */
+template <typename T = std::string>
+std::vector<T> argparse(int argc, const char **argv) {
+  return detail::parse_arguments<std::vector<T>, false>(argc, argv);
+}
+
+/**
+ * Parse command line arguments as above, into a small_vector that keeps
+ * the first N inline. Up to N numbers are parsed without allocating.
+ */
+template <typename T, size_t N>
+small_vector<T, N> argparse(int argc, const char **argv) {
+  return detail::parse_arguments<small_vector<T, N>, false>(argc, argv);
+}
+
+/**
+ * Parse command line arguments into a vector of a given type, where
+ * each number must be the whole argument, as parse requires. Unlike
+ * argparse, this never consults the locale.
+ * THROWS: std::invalid_argument if an argument is not a valid number.
+ */
+template <typename T = std::string>
+std::vector<T> argparse_strict(int argc, const char **argv) {
+  return detail::parse_arguments<std::vector<T>, true>(argc, argv);
+}
+
+/**
+ * Parse command line arguments as above, into a small_vector that keeps
+ * the first N inline.
+ * THROWS: std::invalid_argument if an argument is not a valid number.
+ */
+template <typename T, size_t N>
+small_vector<T, N> argparse_strict(int argc, const char **argv) {
+  return detail::parse_arguments<small_vector<T, N>, true>(argc, argv);
+}
+
 /**
  * Basic printing utility for pairs of any type.
  */
@@ -51,40 +185,1157 @@ std::ostream &operator<<(std::ostream &os, const std::pair<S, T> &p) {
   return os << '(' << p.first << ", " << p.second << ')';
 }
 
+/**
+ * Basic printing utility for tuples of any type.
+ */
+template <typename... Ts>
+std::ostream &operator<<(std::ostream &os, const std::tuple<Ts...> &t) {
+  os << '(';
+  if constexpr (sizeof...(Ts) > 0) {
+    std::apply(
+        [&os](const auto &first, const auto &... rest) {
+          os << first;
+          ((os << ", " << rest), ...);
+        },
+        t);
+  }
+  return os << ')';
+}
+
+namespace detail {
+
+/**
+ * Whether T is printed as a character.
+ */
+template <typename T>
+constexpr bool is_character_v =
+    std::is_same_v<T, char> || std::is_same_v<T, signed char> ||
+    std::is_same_v<T, unsigned char> || std::is_same_v<T, wchar_t> ||
+    std::is_same_v<T, char16_t> || std::is_same_v<T, char32_t>;
+
+/**
+ * Whether T can be formatted without a stream: numbers through
+ * std::to_chars, and chars or strings by copying.
+ */
+template <typename T>
+constexpr bool is_fast_printable_v =
+    (std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+     !is_character_v<T>) ||
+    std::is_same_v<T, char> ||
+    std::is_convertible_v<const T &, std::string_view>;
+
+/**
+ * Whether os would format numbers and strings exactly as the fast path
+ * does: default flags, no field width, the classic locale, and a float
+ * precision small enough for a fixed size scratch space.
+ */
+inline bool is_plain_stream(const std::ostream &os) {
+  return os.flags() == (std::ios::dec | std::ios::skipws) && os.width() == 0 &&
+         os.precision() <= 32 && os.getloc() == std::locale::classic();
+}
+
+/**
+ * Large output buffer that formats items in place and hands them to a
+ * stream or file descriptor in big writes. Nothing is written until flush.
+ * THROWS: std::system_error if writing to a file descriptor fails.
+ */
+class print_buffer {
+ private:
+  static constexpr size_t capacity = size_t(1) << 16;
+
+  char m_data[capacity];
+  size_t m_size;
+  std::ostream *m_os;
+  const int m_fd;
+  const int m_precision;
+
+  /**
+   * Formats items that have no fast path.
+   */
+  std::ostringstream m_text;
+
+  /**
+   * Writes [data, data + size) to the destination.
+   */
+  void sink(const char *, size_t);
+
+  /**
+   * Makes room for at least size more bytes.
+   */
+  void reserve(size_t);
+
+ public:
+  print_buffer() = delete;
+
+  explicit print_buffer(std::ostream &);
+  explicit print_buffer(int fd);
+
+  print_buffer(const print_buffer &) = delete;
+  print_buffer &operator=(const print_buffer &) = delete;
+
+  /**
+   * Appends raw text.
+   */
+  void write(std::string_view);
+
+  /**
+   * Appends an item formatted as operator<< would on a default stream.
+   */
+  template <typename T>
+  void write_item(const T &);
+
+  /**
+   * Writes out everything appended so far.
+   */
+  void flush();
+};
+
+inline print_buffer::print_buffer(std::ostream &os)
+    : m_size(0),
+      m_os(&os),
+      m_fd(-1),
+      m_precision(static_cast<int>(os.precision())) {}
+
+inline print_buffer::print_buffer(int fd)
+    : m_size(0), m_os(nullptr), m_fd(fd), m_precision(6) {}
+
+inline void print_buffer::sink(const char *data, size_t size) {
+  if (m_os) {
+    m_os->write(data, static_cast<std::streamsize>(size));
+    return;
+  }
+  // Writes may be partial or interrupted by signals.
+  while (size > 0) {
+    const auto written = ::write(m_fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      throw std::system_error(errno, std::generic_category(),
+                              "Could not write to file descriptor");
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+}
+
+inline void print_buffer::reserve(size_t size) {
+  if (capacity - m_size < size) flush();
+}
+
+inline void print_buffer::write(std::string_view text) {
+  reserve(text.size());
+  if (text.size() >= capacity) {
+    sink(text.data(), text.size());
+    return;
+  }
+  std::copy(text.begin(), text.end(), m_data + m_size);
+  m_size += text.size();
+}
+
+template <typename T>
+inline void print_buffer::write_item(const T &item) {
+  if constexpr (std::is_same_v<T, char>) {
+    write(std::string_view(&item, 1));
+  } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+    write(std::string_view(item));
+  } else if constexpr (is_fast_printable_v<T>) {
+    // Enough for any integer, or any float at precision 32.
+    reserve(64);
+    const auto first = m_data + m_size;
+    std::to_chars_result status;
+    if constexpr (std::is_floating_point_v<T>) {
+      status = std::to_chars(first, m_data + capacity, item,
+                             std::chars_format::general, m_precision);
+    } else {
+      status = std::to_chars(first, m_data + capacity, item);
+    }
+    m_size += static_cast<size_t>(status.ptr - first);
+  } else {
+    m_text.str(std::string());
+    m_text << item;
+    write(m_text.str());
+  }
+}
+
+inline void print_buffer::flush() {
+  sink(m_data, m_size);
+  m_size = 0;
+}
+
+/**
+ * REQUIRES: start != stop.
+ * Appends every item in the range, separated by sep, then end.
+ */
+template <typename InputIterator, typename Sentinel>
+void print_items(print_buffer &buffer, InputIterator start, Sentinel stop,
+                 std::string_view sep, std::string_view end) {
+  buffer.write_item(*start);
+  for (++start; start != stop; ++start) {
+    buffer.write(sep);
+    buffer.write_item(*start);
+  }
+  buffer.write(end);
+  buffer.flush();
+}
+
+}  // namespace detail
+
 /**
  * Prints all items in the range [begin, end) to cout.
- * Entries are separated by sep.
+ * Entries are separated by sep. The end of the range
+ * may be a sentinel of a different type than start.
+ * Numbers, chars and strings printed to a stream with default
+ * formatting are formatted into a large buffer and written in bulk.
  */
-template <typename InputIterator>
-void print_range(InputIterator start, InputIterator stop, std::string sep = " ",
+template <typename InputIterator, typename Sentinel>
+void print_range(InputIterator start, Sentinel stop, std::string sep = " ",
                  std::string end = "\n", std::ostream &os = std::cout) {
-  for (auto iter = start; iter != stop; ++iter) {
-    if (std::next(iter) != stop)
-      os << *iter << sep;
-    else
-      os << *iter << end;
+  if (start == stop) return;
+  using item_type = std::decay_t<decltype(*start)>;
+  if constexpr (detail::is_fast_printable_v<item_type>) {
+    if (detail::is_plain_stream(os)) {
+      detail::print_buffer buffer(os);
+      detail::print_items(buffer, start, stop, sep, end);
+      return;
+    }
   }
+  os << *start;
+  for (++start; start != stop; ++start) os << sep << *start;
+  os << end;
 }
 
 /**
- * Returns the character or word count in the file.
+ * Prints all items in the range [begin, end) straight to a file
+ * descriptor, bypassing streams entirely. Items are formatted as on
+ * a default stream and written in large blocks.
+ * THROWS: std::system_error if writing fails.
  */
-template <typename T>
-size_t wc(const std::string &filename) {
-  std::ifstream fin(filename);
-  if constexpr (sizeof(T) == 1) fin >> std::noskipws;
-  size_t counter = 0;
-  for (T c; fin >> c; ++counter) continue;
-  return counter;
+template <typename InputIterator, typename Sentinel>
+void print_range(InputIterator start, Sentinel stop, std::string sep,
+                 std::string end, int fd) {
+  if (start == stop) return;
+  detail::print_buffer buffer(fd);
+  detail::print_items(buffer, start, stop, sep, end);
+}
+
+/**
+ * Read-only memory mapping of an entire file, released on destruction.
+ * The sequential flag hints to the kernel that the mapping will be
+ * read front to back, so pages can be read ahead aggressively.
+ * THROWS: std::system_error if the file cannot be opened or mapped.
+ */
+class mapped_file {
+ private:
+  const char *m_data;
+  size_t m_size;
+
+ public:
+  mapped_file() = delete;
+
+  /**
+   * Maps the named file into memory.
+   */
+  explicit mapped_file(const std::string &, bool sequential = true);
+
+  // Mappings are unique, so they can be moved but not copied.
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+  mapped_file(mapped_file &&) noexcept;
+  mapped_file &operator=(mapped_file &&) noexcept;
+
+  ~mapped_file();
+
+  /**
+   * Pointer to the first byte of the file. Null for an empty file.
+   */
+  const char *data() const;
+
+  /**
+   * Number of bytes in the file.
+   */
+  size_t size() const;
+
+  // Iteration over the bytes of the file.
+
+  const char *begin() const;
+  const char *end() const;
+
+  /**
+   * The contents of the file as a string view.
+   */
+  std::string_view view() const;
+};
+
+inline mapped_file::mapped_file(const std::string &filename, bool sequential)
+    : m_data(nullptr), m_size(0) {
+  const auto fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "Could not open " + filename);
+  }
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    const auto code = errno;
+    ::close(fd);
+    throw std::system_error(code, std::generic_category(),
+                            "Could not stat " + filename);
+  }
+  m_size = static_cast<size_t>(info.st_size);
+  // Zero length mappings are invalid, so empty files stay unmapped.
+  if (m_size > 0) {
+    const auto addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const auto code = errno;
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      throw std::system_error(code, std::generic_category(),
+                              "Could not map " + filename);
+    }
+    if (sequential) ::madvise(addr, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char *>(addr);
+  } else {
+    ::close(fd);
+  }
+}
+
+inline mapped_file::mapped_file(mapped_file &&other) noexcept
+    : m_data(other.m_data), m_size(other.m_size) {
+  other.m_data = nullptr;
+  other.m_size = 0;
+}
+
+inline mapped_file &mapped_file::operator=(mapped_file &&other) noexcept {
+  std::swap(m_data, other.m_data);
+  std::swap(m_size, other.m_size);
+  return *this;
+}
+
+inline mapped_file::~mapped_file() {
+  if (m_data) ::munmap(const_cast<char *>(m_data), m_size);
+}
+
+inline const char *mapped_file::data() const { return m_data; }
+
+inline size_t mapped_file::size() const { return m_size; }
+
+inline const char *mapped_file::begin() const { return m_data; }
+
+inline const char *mapped_file::end() const { return m_data + m_size; }
+
+inline std::string_view mapped_file::view() const {
+  return std::string_view(m_data, m_size);
+}
+
+namespace detail {
+
+/**
+ * Opens the named file for reading and returns its descriptor.
+ * THROWS: std::system_error if the file cannot be opened.
+ */
+inline int open_read_only(const std::string &filename) {
+  const auto fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "Could not open " + filename);
+  }
+  return fd;
+}
+
+}  // namespace detail
+
+/**
+ * Double buffered reader over a file descriptor. A background thread
+ * reads the next block while the current one is being scanned, so the
+ * wait on slow storage such as NFS or a pipe overlaps with the work.
+ * Blocks are taken without copying through next, or the reader can be
+ * the buffer of a std::istream for csv_reader, wc_all and the rest,
+ * but the two should not be mixed.
+ */
+class prefetch_reader : public std::streambuf {
+ private:
+  /**
+   * One of the two buffers. The thread fills it while it is empty,
+   * and the owner scans it while it is full.
+   */
+  struct slot {
+    std::vector<char> data;
+    size_t size = 0;
+    bool full = false;
+  };
+
+  const int m_fd;
+  const bool m_owned;
+  slot m_slots[2];
+
+  /**
+   * The slot scanned next, and whether the owner is still scanning it.
+   */
+  size_t m_current = 0;
+  bool m_holding = false;
+
+  std::mutex m_lock;
+  std::condition_variable m_filled;
+  std::condition_variable m_emptied;
+  bool m_stopping = false;
+  int m_error = 0;
+  std::thread m_worker;
+
+  /**
+   * Constructor that gives parameters. Closes fd on failure if owned.
+   */
+  prefetch_reader(int, size_t, bool);
+
+  /**
+   * Fills the slots in turn until input runs out or reading fails.
+   */
+  void run();
+
+ protected:
+  int_type underflow() override;
+
+ public:
+  static constexpr size_t default_block = size_t(1) << 20;
+
+  prefetch_reader() = delete;
+
+  /**
+   * Reads from fd, which is left open. REQUIRES: fd outlives the reader.
+   */
+  explicit prefetch_reader(int fd, size_t block = default_block);
+
+  /**
+   * Reads from the named file.
+   * THROWS: std::system_error if the file cannot be opened.
+   */
+  explicit prefetch_reader(const std::string &, size_t block = default_block);
+
+  // The thread refers to the reader, so it is neither copied nor moved.
+
+  prefetch_reader(const prefetch_reader &) = delete;
+  prefetch_reader &operator=(const prefetch_reader &) = delete;
+
+  /**
+   * Waits for a read in progress to return, then stops the thread.
+   */
+  ~prefetch_reader() override;
+
+  /**
+   * Hands back the previous block for refilling, then sets block to
+   * the next one as soon as it has been read. Each block holds what one
+   * read returned, so blocks from pipes and sockets may be short.
+   * Returns false once input runs out.
+   * REQUIRES: block is not used after the following call.
+   * THROWS: std::system_error if reading fails.
+   */
+  bool next(std::string_view &block);
+};
+
+inline prefetch_reader::prefetch_reader(int fd, size_t block, bool owned)
+    : m_fd(fd), m_owned(owned) {
+  try {
+    for (auto &buffer : m_slots) {
+      buffer.data.resize(block > 0 ? block : default_block);
+    }
+    ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    m_worker = std::thread(&prefetch_reader::run, this);
+  } catch (...) {
+    if (m_owned) ::close(m_fd);
+    throw;
+  }
+}
+
+inline prefetch_reader::prefetch_reader(int fd, size_t block)
+    : prefetch_reader(fd, block, false) {}
+
+inline prefetch_reader::prefetch_reader(const std::string &filename,
+                                        size_t block)
+    : prefetch_reader(detail::open_read_only(filename), block, true) {}
+
+inline prefetch_reader::~prefetch_reader() {
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_stopping = true;
+  }
+  m_emptied.notify_all();
+  m_worker.join();
+  if (m_owned) ::close(m_fd);
+}
+
+inline void prefetch_reader::run() {
+  for (size_t index = 0;; index ^= 1) {
+    auto &buffer = m_slots[index];
+    {
+      std::unique_lock<std::mutex> guard(m_lock);
+      m_emptied.wait(guard, [&] { return m_stopping || !buffer.full; });
+      if (m_stopping) return;
+    }
+    // Hand over whatever one read returns, so that data arriving slowly
+    // on a pipe or socket is scanned while the next read waits.
+    ssize_t got;
+    do {
+      got = ::read(m_fd, buffer.data.data(), buffer.data.size());
+    } while (got < 0 && errno == EINTR);
+    const auto size = got > 0 ? static_cast<size_t>(got) : 0;
+    const auto error = got < 0 ? errno : 0;
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      buffer.size = size;
+      buffer.full = true;
+      m_error = error;
+    }
+    m_filled.notify_one();
+    // The end is marked by an empty block.
+    if (size == 0 || error != 0) return;
+  }
+}
+
+inline bool prefetch_reader::next(std::string_view &block) {
+  std::unique_lock<std::mutex> guard(m_lock);
+  if (m_holding) {
+    m_slots[m_current].full = false;
+    m_holding = false;
+    m_current ^= 1;
+    m_emptied.notify_one();
+  }
+  auto &buffer = m_slots[m_current];
+  m_filled.wait(guard, [&] { return buffer.full || m_error != 0; });
+  // Data read before an error is still handed out first.
+  if (m_error != 0 && (!buffer.full || buffer.size == 0)) {
+    throw std::system_error(m_error, std::generic_category(),
+                            "Could not read from file descriptor");
+  }
+  // The empty last block stays full, so later calls also return false.
+  if (buffer.size == 0) return false;
+  m_holding = true;
+  block = std::string_view(buffer.data.data(), buffer.size);
+  return true;
+}
+
+inline prefetch_reader::int_type prefetch_reader::underflow() {
+  std::string_view block;
+  if (!next(block)) return traits_type::eof();
+  const auto first = const_cast<char *>(block.data());
+  setg(first, first, first + block.size());
+  return traits_type::to_int_type(*first);
 }
 
 // Used for template specialization of wc.
 struct line {};
 
-template <>
-size_t wc<line>(const std::string &filename) {
-  std::ifstream fin(filename);
+// Used for template specialization of wc: UTF-8 code points.
+struct utf8_char {};
+
+// Used for template specialization of wc: words separated by Unicode
+// whitespace in UTF-8 text.
+struct utf8_word {};
+
+namespace detail {
+
+/**
+ * Read-only stream buffer over a region of memory, so that stream
+ * extraction can run over a mapping without copying it.
+ */
+class memory_buffer : public std::streambuf {
+ public:
+  memory_buffer(const char *first, const char *last) {
+    setg(const_cast<char *>(first), const_cast<char *>(first),
+         const_cast<char *>(last));
+  }
+};
+
+}  // namespace detail
+
+/**
+ * Returns the character, word, or line count in the mapped file.
+ * utf8_char and utf8_word count UTF-8 text, where each byte that is not
+ * part of a well-formed sequence counts as one character.
+ */
+template <typename T>
+size_t wc(const mapped_file &file) {
+  instrument_probe probe(instrumented::wc);
+  probe.add_bytes(file.size());
+  if constexpr (std::is_same_v<T, line>) {
+    // Like getline, a final line without a newline still counts.
+    if (file.size() == 0) return 0;
+    return detail::count_byte(file.begin(), file.end(), '\n') +
+           (*std::prev(file.end()) != '\n');
+  } else if constexpr (std::is_integral_v<T> && sizeof(T) == 1 &&
+                       !std::is_same_v<T, bool>) {
+    // Every byte is a character.
+    return file.size();
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    bool after_space = true;
+    return detail::count_words(file.begin(), file.end(), after_space);
+  } else if constexpr (std::is_same_v<T, utf8_char>) {
+    return detail::count_utf8(file.begin(), file.end());
+  } else if constexpr (std::is_same_v<T, utf8_word>) {
+    bool after_space = true;
+    return detail::count_utf8_words(file.begin(), file.end(), after_space);
+  } else {
+    detail::memory_buffer buffer(file.begin(), file.end());
+    std::istream is(&buffer);
+    size_t counter = 0;
+    for (T c; is >> c; ++counter) continue;
+    return counter;
+  }
+}
+
+namespace detail {
+
+/**
+ * Whether the named file is a regular file with a size. Others, such
+ * as procfs files, FIFOs and /dev/stdin, report a size of zero even
+ * when they have content, so they have to be read instead of mapped.
+ */
+inline bool is_mappable(const std::string &filename) {
+  struct stat info;
+  return ::stat(filename.c_str(), &info) == 0 && S_ISREG(info.st_mode) &&
+         info.st_size > 0;
+}
+
+/**
+ * Returns the character, word, or line count of the blocks of reader,
+ * as wc does for a mapped file. UTF-8 sequences cut off at the end of a
+ * block are carried over to the next.
+ * THROWS: std::system_error if reading fails.
+ */
+template <typename T>
+size_t wc_stream(prefetch_reader &reader) {
+  instrument_probe probe(instrumented::wc);
   size_t counter = 0;
-  for (std::string line; std::getline(fin, line); ++counter) continue;
+  if constexpr (std::is_same_v<T, line> || std::is_same_v<T, std::string> ||
+                (std::is_integral_v<T> && sizeof(T) == 1 &&
+                 !std::is_same_v<T, bool>)) {
+    bool after_space = true;
+    bool after_newline = true;
+    for (std::string_view block; reader.next(block);) {
+      if (block.empty()) continue;
+      probe.add_bytes(block.size());
+      const auto first = block.data();
+      const auto last = first + block.size();
+      if constexpr (std::is_same_v<T, line>) {
+        counter += count_byte(first, last, '\n');
+        after_newline = block.back() == '\n';
+      } else if constexpr (std::is_same_v<T, std::string>) {
+        counter += count_words(first, last, after_space);
+      } else {
+        counter += block.size();
+      }
+    }
+    // Like getline, a final line without a newline still counts.
+    if constexpr (std::is_same_v<T, line>) counter += !after_newline;
+  } else if constexpr (std::is_same_v<T, utf8_char> ||
+                       std::is_same_v<T, utf8_word>) {
+    // Holds a sequence cut off at the end of a block, which is at most
+    // 4 bytes once the next block completes it.
+    char carry[4];
+    size_t held = 0;
+    bool after_space = true;
+    const auto count = [&counter, &after_space](const char *first,
+                                                const char *last) {
+      if constexpr (std::is_same_v<T, utf8_char>) {
+        counter += count_utf8(first, last);
+      } else {
+        counter += count_utf8_words(first, last, after_space);
+      }
+    };
+    for (std::string_view block; reader.next(block);) {
+      probe.add_bytes(block.size());
+      auto first = block.data();
+      const auto last = first + block.size();
+      if (held != 0) {
+        // Only continuation bytes can finish the carried sequence.
+        while (first != last && held != sizeof(carry) &&
+               (static_cast<unsigned char>(*first) & 0xC0) == 0x80) {
+          carry[held++] = *first++;
+        }
+        if (first == last && held != sizeof(carry)) continue;
+        count(carry, carry + held);
+        held = 0;
+      }
+      held = utf8_partial(first, last);
+      count(first, last - held);
+      std::copy(last - held, last, carry);
+    }
+    count(carry, carry + held);
+  } else {
+    std::istream is(&reader);
+    // Otherwise the stream would swallow read errors as the end.
+    is.exceptions(std::ios::badbit);
+    for (T c; is >> c; ++counter) continue;
+  }
   return counter;
 }
+
+}  // namespace detail
+
+/**
+ * Returns the character, word, or line count in the file. Regular files
+ * are mapped, and anything else is read a block at a time.
+ * THROWS: std::system_error if the file cannot be opened or read.
+ */
+template <typename T>
+size_t wc(const std::string &filename) {
+  if (detail::is_mappable(filename)) return wc<T>(mapped_file(filename));
+  prefetch_reader reader(filename);
+  return detail::wc_stream<T>(reader);
+}
+
+/**
+ * Returns the character, word, or line count in the mapped file,
+ * splitting the work into page-aligned chunks counted in parallel.
+ * REQUIRES: T is line, std::string, or a character type.
+ * THROWS: std::system_error if a thread cannot be started.
+ */
+template <typename T>
+size_t wc_parallel(const mapped_file &file,
+                   unsigned threads = std::thread::hardware_concurrency()) {
+  static_assert(std::is_same_v<T, line> || std::is_same_v<T, std::string> ||
+                (std::is_integral_v<T> && sizeof(T) == 1 &&
+                 !std::is_same_v<T, bool>));
+  instrument_probe probe(instrumented::wc);
+  probe.add_bytes(file.size());
+  if constexpr (!std::is_same_v<T, line> && !std::is_same_v<T, std::string>) {
+    return file.size();
+  } else {
+    // Round chunks up to whole pages so no page is touched by two threads.
+    const auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const auto workers = threads > 0 ? threads : 1u;
+    const auto pages = (file.size() + page - 1) / page;
+    const auto chunk = (pages + workers - 1) / workers * page;
+    if (chunk == 0) return 0;
+
+    std::vector<size_t> counts((file.size() + chunk - 1) / chunk);
+    std::vector<std::thread> pool;
+    pool.reserve(counts.size());
+    try {
+      for (size_t i = 0; i < counts.size(); ++i) {
+        pool.emplace_back([&file, &counts, chunk, i] {
+          const auto first = file.begin() + i * chunk;
+          const auto last =
+              i + 1 == counts.size() ? file.end() : first + chunk;
+          if constexpr (std::is_same_v<T, line>) {
+            counts[i] = detail::count_byte(first, last, '\n');
+          } else {
+            // A word crossing into this chunk belongs to the previous one.
+            bool after_space = i == 0 || detail::is_space(*std::prev(first));
+            counts[i] = detail::count_words(first, last, after_space);
+          }
+        });
+      }
+    } catch (...) {
+      // Destroying a joinable thread would terminate the program.
+      for (auto &worker : pool) worker.join();
+      throw;
+    }
+    for (auto &worker : pool) worker.join();
+
+    size_t counter = 0;
+    for (auto count : counts) counter += count;
+    // Like getline, a final line without a newline still counts.
+    if constexpr (std::is_same_v<T, line>) {
+      counter += *std::prev(file.end()) != '\n';
+    }
+    return counter;
+  }
+}
+
+/**
+ * Returns the character, word, or line count in the file,
+ * splitting the work into page-aligned chunks counted in parallel.
+ * Files that cannot be mapped are counted by wc instead.
+ * THROWS: std::system_error if the file cannot be opened or read.
+ */
+template <typename T>
+size_t wc_parallel(const std::string &filename,
+                   unsigned threads = std::thread::hardware_concurrency()) {
+  if (!detail::is_mappable(filename)) return wc<T>(filename);
+  return wc_parallel<T>(mapped_file(filename), threads);
+}
+
+/**
+ * Line, word, and byte counts of one input, as printed by wc.
+ */
+struct wc_counts {
+  size_t lines = 0;
+  size_t words = 0;
+  size_t bytes = 0;
+};
+
+namespace detail {
+
+/**
+ * Accumulates wc_counts over consecutive blocks of one input. Each block
+ * is counted in cache-sized windows, so the line and word kernels read
+ * the same bytes while they are still in cache.
+ */
+class wc_accumulator {
+ private:
+  wc_counts m_counts;
+  bool m_after_space = true;
+  bool m_after_newline = true;
+
+ public:
+  /**
+   * Counts the block [first, last), which follows every earlier block.
+   */
+  void add(const char *first, const char *last) {
+    if (first == last) return;
+    constexpr ptrdiff_t window = 16 * 1024;
+    m_counts.bytes += static_cast<size_t>(last - first);
+    while (first != last) {
+      const auto stop = last - first > window ? first + window : last;
+      m_counts.lines += count_byte(first, stop, '\n');
+      m_counts.words += count_words(first, stop, m_after_space);
+      first = stop;
+    }
+    m_after_newline = *std::prev(last) == '\n';
+  }
+
+  /**
+   * The counts so far. Like getline, a final line without a newline
+   * still counts.
+   */
+  wc_counts counts() const {
+    auto counts = m_counts;
+    counts.lines += !m_after_newline;
+    return counts;
+  }
+};
+
+/**
+ * Returns the line, word, and byte counts of the blocks of reader.
+ * THROWS: std::system_error if reading fails.
+ */
+inline wc_counts wc_all_blocks(prefetch_reader &reader) {
+  instrument_probe probe(instrumented::wc);
+  wc_accumulator accumulator;
+  for (std::string_view block; reader.next(block);) {
+    accumulator.add(block.data(), block.data() + block.size());
+    probe.add_bytes(block.size());
+  }
+  return accumulator.counts();
+}
+
+}  // namespace detail
+
+/**
+ * Returns the line, word, and byte counts of the mapped file,
+ * found in a single pass over the mapping.
+ */
+inline wc_counts wc_all(const mapped_file &file) {
+  instrument_probe probe(instrumented::wc);
+  probe.add_bytes(file.size());
+  detail::wc_accumulator accumulator;
+  accumulator.add(file.begin(), file.end());
+  return accumulator.counts();
+}
+
+/**
+ * Returns the line, word, and byte counts of the file. Regular files
+ * are mapped, and anything else is read a block at a time.
+ * THROWS: std::system_error if the file cannot be opened or read.
+ */
+inline wc_counts wc_all(const std::string &filename) {
+  if (detail::is_mappable(filename)) return wc_all(mapped_file(filename));
+  prefetch_reader reader(filename);
+  return detail::wc_all_blocks(reader);
+}
+
+/**
+ * Returns the line, word, and byte counts of everything left in is,
+ * read once in large blocks. Works on pipes and other unseekable input.
+ */
+inline wc_counts wc_all(std::istream &is) {
+  instrument_probe probe(instrumented::wc);
+  detail::wc_accumulator accumulator;
+  std::vector<char> buffer(64 * 1024);
+  while (is) {
+    is.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    const auto first = buffer.data();
+    accumulator.add(first, first + is.gcount());
+    probe.add_bytes(static_cast<size_t>(is.gcount()));
+  }
+  return accumulator.counts();
+}
+
+/**
+ * Returns the line, word, and byte counts of everything left to read
+ * from the file descriptor. Blocks are counted while the next is read
+ * by a prefetch_reader. Works on pipes and sockets. The descriptor is
+ * not closed.
+ * THROWS: std::system_error if reading fails.
+ */
+inline wc_counts wc_all(int fd) {
+  prefetch_reader reader(fd);
+  return detail::wc_all_blocks(reader);
+}
+
+/**
+ * Streaming reader of comma or tab separated records. Input is read in
+ * fixed size blocks, and a record cut off at the end of a block is
+ * carried over to the next one, so memory stays bounded by the block
+ * size and the longest record. Each record is returned as views of its
+ * fields, which stay valid until the next record is read.
+ * With quoting, as in RFC 4180, fields that start with a double quote
+ * may contain delimiters, newlines and doubled quotes, which are
+ * unescaped in place. A trailing carriage return is dropped.
+ * THROWS: std::system_error if the named file cannot be opened.
+ */
+class csv_reader {
+ private:
+  std::ifstream m_file;
+  std::istream *m_stream;
+
+  /**
+   * Unread input is [m_begin, m_end) of either the buffer, for streams,
+   * or the region, for mapped files.
+   */
+  std::vector<char> m_buffer;
+  std::string_view m_region;
+  size_t m_begin;
+  size_t m_end;
+
+  /**
+   * Scratch space for unescaping quoted records of read-only regions.
+   */
+  std::string m_scratch;
+
+  const char m_delim;
+  const bool m_quoted;
+
+  /**
+   * Start of the unread input.
+   */
+  const char *data() const;
+
+  /**
+   * Moves the unread input to the front of the buffer, growing it if
+   * full, then reads another block. Returns false once input runs out.
+   */
+  bool fill();
+
+  /**
+   * Finds the next record as [first, first + size). Returns false
+   * once input runs out. Sets quotes if the record has a quoted field.
+   */
+  bool next_record(size_t &first, size_t &size, bool &quotes);
+
+  /**
+   * Splits a record without quotes into fields.
+   */
+  void split_plain(const char *, const char *,
+                   std::vector<std::string_view> &) const;
+
+  /**
+   * Splits a record with quotes into fields, unescaping in place.
+   */
+  void split_quoted(char *, char *, std::vector<std::string_view> &) const;
+
+ public:
+  static constexpr size_t default_block = size_t(1) << 16;
+
+  csv_reader() = delete;
+
+  /**
+   * Reads records from the named file.
+   */
+  explicit csv_reader(const std::string &, char delim = ',', bool quoted = true,
+                      size_t block = default_block);
+
+  /**
+   * Reads records from a stream. REQUIRES: input outlives the reader.
+   */
+  explicit csv_reader(std::istream &, char delim = ',', bool quoted = true,
+                      size_t block = default_block);
+
+  /**
+   * Reads records straight from a mapping, so nothing is buffered.
+   * REQUIRES: file outlives the reader and its records.
+   */
+  explicit csv_reader(const mapped_file &, char delim = ',',
+                      bool quoted = true);
+
+  // Readers refer to their own stream, so they are neither copied nor moved.
+
+  csv_reader(const csv_reader &) = delete;
+  csv_reader &operator=(const csv_reader &) = delete;
+
+  /**
+   * Replaces fields with the fields of the next record. A blank line
+   * gives no fields. Returns false once every record has been read.
+   */
+  bool next(std::vector<std::string_view> &fields);
+};
+
+inline csv_reader::csv_reader(const std::string &filename, char delim,
+                              bool quoted, size_t block)
+    : m_file(filename, std::ios::binary),
+      m_stream(&m_file),
+      m_buffer(block > 0 ? block : default_block),
+      m_begin(0),
+      m_end(0),
+      m_delim(delim),
+      m_quoted(quoted) {
+  if (!m_file) {
+    throw std::system_error(errno, std::generic_category(),
+                            "Could not open " + filename);
+  }
+}
+
+inline csv_reader::csv_reader(std::istream &input, char delim, bool quoted,
+                              size_t block)
+    : m_stream(&input),
+      m_buffer(block > 0 ? block : default_block),
+      m_begin(0),
+      m_end(0),
+      m_delim(delim),
+      m_quoted(quoted) {}
+
+inline csv_reader::csv_reader(const mapped_file &file, char delim,
+                              bool quoted)
+    : m_stream(nullptr),
+      m_region(file.view()),
+      m_begin(0),
+      m_end(file.size()),
+      m_delim(delim),
+      m_quoted(quoted) {}
+
+inline const char *csv_reader::data() const {
+  return m_stream ? m_buffer.data() : m_region.data();
+}
+
+inline bool csv_reader::fill() {
+  if (!m_stream) return false;
+  // Carry the partial record over to the front of the buffer.
+  std::copy(m_buffer.begin() + static_cast<ptrdiff_t>(m_begin),
+            m_buffer.begin() + static_cast<ptrdiff_t>(m_end), m_buffer.begin());
+  m_end -= m_begin;
+  m_begin = 0;
+  // A record longer than the buffer needs more room.
+  if (m_end == m_buffer.size()) m_buffer.resize(2 * m_buffer.size());
+  m_stream->read(m_buffer.data() + m_end,
+                 static_cast<std::streamsize>(m_buffer.size() - m_end));
+  const auto count = static_cast<size_t>(m_stream->gcount());
+  m_end += count;
+  return count > 0;
+}
+
+inline bool csv_reader::next_record(size_t &first, size_t &size,
+                                    bool &quotes) {
+  // Bytes before scan follow the rules of split_quoted: a quote opens a
+  // quoted field only at the start of a field, and inside one, a doubled
+  // quote is an escaped quote. Elsewhere quotes are plain characters.
+  auto scan = m_begin;
+  bool in_quotes = false;
+  quotes = false;
+  while (true) {
+    const auto base = data();
+    const auto stop = base + m_end;
+    if (in_quotes) {
+      const auto quote = detail::find_byte(base + scan, stop, '"');
+      if (quote != stop && std::next(quote) != stop) {
+        in_quotes = quote[1] == '"';
+        scan = static_cast<size_t>(quote - base) + (in_quotes ? 2 : 1);
+        continue;
+      }
+      // A quote at the end of the input may turn out to be doubled.
+      scan = static_cast<size_t>(quote - base);
+    } else {
+      const auto newline = detail::find_byte(base + scan, stop, '\n');
+      auto quote = newline;
+      if (m_quoted) {
+        const auto record = base + m_begin;
+        quote = detail::find_byte(base + scan, newline, '"');
+        // Skip quotes in the middle of unquoted fields.
+        while (quote != newline && quote != record && quote[-1] != m_delim) {
+          quote = detail::find_byte(std::next(quote), newline, '"');
+        }
+      }
+      if (quote != newline) {
+        in_quotes = quotes = true;
+        scan = static_cast<size_t>(quote - base) + 1;
+        continue;
+      }
+      if (newline != stop) {
+        // The record ends at the first newline outside of quotes.
+        first = m_begin;
+        size = static_cast<size_t>(newline - base) - m_begin;
+        m_begin += size + 1;
+        return true;
+      }
+      scan = m_end;
+    }
+    const auto offset = scan - m_begin;
+    if (!fill()) break;
+    scan = m_begin + offset;
+  }
+  // The last record may not end with a newline.
+  if (m_begin == m_end) return false;
+  first = m_begin;
+  size = m_end - m_begin;
+  m_begin = m_end;
+  return true;
+}
+
+inline void csv_reader::split_plain(
+    const char *first, const char *last,
+    std::vector<std::string_view> &fields) const {
+  while (true) {
+    const auto spot = detail::find_byte(first, last, m_delim);
+    fields.emplace_back(first, static_cast<size_t>(spot - first));
+    if (spot == last) return;
+    first = std::next(spot);
+  }
+}
+
+inline void csv_reader::split_quoted(
+    char *first, char *last, std::vector<std::string_view> &fields) const {
+  while (true) {
+    if (first != last && *first == '"') {
+      // Unescape the quoted field over itself, which only shrinks it.
+      const auto field = first;
+      auto write = first;
+      for (++first; first != last; ++first) {
+        if (*first == '"') {
+          if (std::next(first) == last || first[1] != '"') {
+            ++first;
+            break;
+          }
+          ++first;
+        }
+        *write++ = *first;
+      }
+      // Anything between the closing quote and the delimiter is kept.
+      for (; first != last && *first != m_delim; ++first) *write++ = *first;
+      fields.emplace_back(field, static_cast<size_t>(write - field));
+    } else {
+      const auto spot = detail::find_byte(first, last, m_delim);
+      fields.emplace_back(first, static_cast<size_t>(spot - first));
+      first += spot - first;  // The same position, but writable.
+    }
+    if (first == last) return;
+    ++first;
+  }
+}
+
+inline bool csv_reader::next(std::vector<std::string_view> &fields) {
+  fields.clear();
+  size_t first;
+  size_t size;
+  bool quotes;
+  if (!next_record(first, size, quotes)) return false;
+  const auto record = data() + first;
+  if (size > 0 && record[size - 1] == '\r') --size;
+  if (size == 0) return true;
+  if (!quotes) {
+    split_plain(record, record + size, fields);
+  } else if (m_stream) {
+    const auto writable = m_buffer.data() + first;
+    split_quoted(writable, writable + size, fields);
+  } else {
+    // Mapped regions are read-only, so unescape a copy.
+    m_scratch.assign(record, size);
+    split_quoted(m_scratch.data(), m_scratch.data() + size, fields);
+  }
+  return true;
+}
@@ -0,0 +1,748 @@
+/*
+Copyright 2020. Siwei Wang.
+
+Lazy composable adaptors chained with the pipe operator.
+*/
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace detail {
+
+/**
+ * How a view refers to the range it adapts. Ranges passed as lvalues
+ * are referred to, as zip and enumerate do. Ranges passed as rvalues,
+ * such as a range object or another view, are moved into the view.
+ */
+template <typename R>
+using view_base = std::conditional_t<std::is_lvalue_reference_v<R>, R,
+                                     const std::remove_reference_t<R> &>;
+
+template <typename R>
+using view_iterator = decltype(std::begin(std::declval<view_base<R>>()));
+
+template <typename R>
+using view_sentinel = decltype(std::end(std::declval<view_base<R>>()));
+
+/**
+ * Adapted iterators are forward when the underlying iterators are,
+ * and input iterators otherwise.
+ */
+template <typename Iter>
+using view_category = std::conditional_t<
+    std::is_base_of_v<std::forward_iterator_tag,
+                      typename std::iterator_traits<Iter>::iterator_category>,
+    std::forward_iterator_tag, std::input_iterator_tag>;
+
+// Arguments of each adaptor, waiting to be piped a range.
+
+template <typename Pred>
+struct filter_closure {
+  Pred pred;
+};
+
+template <typename Function>
+struct map_closure {
+  Function fn;
+};
+
+struct take_closure {
+  size_t count;
+};
+
+struct chunk_closure {
+  size_t size;
+};
+
+}  // namespace detail
+
+/**
+ * Lazy view of the items of a range that satisfy a predicate.
+ * REQUIRES: R is iterable and outlives the view if it is an lvalue.
+ */
+template <typename R, typename Pred>
+class filter_view {
+ private:
+  using base_iter = detail::view_iterator<R>;
+  using base_sent = detail::view_sentinel<R>;
+  using traits = std::iterator_traits<base_iter>;
+
+  std::conditional_t<std::is_lvalue_reference_v<R>, R,
+                     std::remove_reference_t<R>>
+      m_base;
+  Pred m_pred;
+
+ public:
+  filter_view() = delete;
+
+  /**
+   * Filter view should be passed the range and predicate.
+   */
+  filter_view(R &&, Pred);
+
+  /**
+   * Marks the end of the view.
+   */
+  class sentinel {};
+
+  // Declare forward iterators.
+  class iterator {
+    friend class filter_view;
+
+   private:
+    const filter_view *m_parent;
+    base_iter m_current;
+    base_sent m_end;
+
+    /**
+     * Constructor that finds the first match at or after current.
+     */
+    iterator(const filter_view *, base_iter, base_sent);
+
+    /**
+     * Moves to the first match at or after the current item.
+     */
+    void satisfy();
+
+   public:
+    using iterator_category = detail::view_category<base_iter>;
+    using value_type = typename traits::value_type;
+    using difference_type = typename traits::difference_type;
+    using pointer = void;
+    using reference = typename traits::reference;
+
+    iterator() = delete;
+
+    // Increment operator.
+
+    iterator &operator++();
+    iterator operator++(int);
+
+    // Dereference operator.
+
+    reference operator*() const;
+
+    // These iterators do not support arrow operators.
+
+    // Comparison operators.
+
+    bool operator==(const iterator &) const;
+    bool operator!=(const iterator &) const;
+    bool operator==(const sentinel &) const;
+    bool operator!=(const sentinel &) const;
+  };
+
+  /**
+   * An iterator to the first match.
+   */
+  iterator begin() const;
+
+  /**
+   * A sentinel that compares equal to an iterator past the last match.
+   */
+  sentinel end() const;
+};
+
+/**
+ * Lazy view of the results of applying a function to each item.
+ * REQUIRES: R is iterable and outlives the view if it is an lvalue.
+ */
+template <typename R, typename Function>
+class map_view {
+ private:
+  using base_iter = detail::view_iterator<R>;
+  using base_sent = detail::view_sentinel<R>;
+  using traits = std::iterator_traits<base_iter>;
+
+  std::conditional_t<std::is_lvalue_reference_v<R>, R,
+                     std::remove_reference_t<R>>
+      m_base;
+  Function m_fn;
+
+ public:
+  map_view() = delete;
+
+  /**
+   * Map view should be passed the range and function.
+   */
+  map_view(R &&, Function);
+
+  /**
+   * Marks the end of the view. Holds the end of the range.
+   */
+  class sentinel {
+    friend class map_view;
+
+   private:
+    base_sent m_end;
+
+    explicit sentinel(base_sent);
+
+   public:
+    sentinel() = delete;
+  };
+
+  // Declare forward iterators.
+  class iterator {
+    friend class map_view;
+
+   private:
+    const map_view *m_parent;
+    base_iter m_current;
+
+    /**
+     * Constructor that gives parameters.
+     */
+    iterator(const map_view *, base_iter);
+
+   public:
+    using iterator_category = detail::view_category<base_iter>;
+    using reference = std::invoke_result_t<const Function &,
+                                           typename traits::reference>;
+    using value_type = std::decay_t<reference>;
+    using difference_type = typename traits::difference_type;
+    using pointer = void;
+
+    iterator() = delete;
+
+    // Increment operator.
+
+    iterator &operator++();
+    iterator operator++(int);
+
+    // Dereference operator. Calls the function.
+
+    reference operator*() const;
+
+    // These iterators do not support arrow operators.
+
+    // Comparison operators.
+
+    bool operator==(const iterator &) const;
+    bool operator!=(const iterator &) const;
+    bool operator==(const sentinel &) const;
+    bool operator!=(const sentinel &) const;
+  };
+
+  /**
+   * An iterator to the result for the first item.
+   */
+  iterator begin() const;
+
+  /**
+   * A sentinel that compares equal to an iterator past the last item.
+   */
+  sentinel end() const;
+};
+
+/**
+ * Lazy view of at most the first count items of a range.
+ * REQUIRES: R is iterable and outlives the view if it is an lvalue.
+ */
+template <typename R>
+class take_view {
+ private:
+  using base_iter = detail::view_iterator<R>;
+  using base_sent = detail::view_sentinel<R>;
+  using traits = std::iterator_traits<base_iter>;
+
+  std::conditional_t<std::is_lvalue_reference_v<R>, R,
+                     std::remove_reference_t<R>>
+      m_base;
+  const size_t m_count;
+
+ public:
+  take_view() = delete;
+
+  /**
+   * Take view should be passed the range and item count.
+   */
+  take_view(R &&, size_t);
+
+  /**
+   * Marks the end of the view. Holds the end of the range.
+   */
+  class sentinel {
+    friend class take_view;
+
+   private:
+    base_sent m_end;
+
+    explicit sentinel(base_sent);
+
+   public:
+    sentinel() = delete;
+  };
+
+  // Declare forward iterators.
+  class iterator {
+    friend class take_view;
+
+   private:
+    base_iter m_current;
+    size_t m_remaining;
+
+    /**
+     * Constructor that gives parameters.
+     */
+    iterator(base_iter, size_t);
+
+   public:
+    using iterator_category = detail::view_category<base_iter>;
+    using value_type = typename traits::value_type;
+    using difference_type = typename traits::difference_type;
+    using pointer = void;
+    using reference = typename traits::reference;
+
+    iterator() = delete;
+
+    // Increment operator.
+
+    iterator &operator++();
+    iterator operator++(int);
+
+    // Dereference operator.
+
+    reference operator*() const;
+
+    // These iterators do not support arrow operators.
+
+    // Comparison operators. True at the end once either
+    // count items were taken or the range is exhausted.
+
+    bool operator==(const iterator &) const;
+    bool operator!=(const iterator &) const;
+    bool operator==(const sentinel &) const;
+    bool operator!=(const sentinel &) const;
+  };
+
+  /**
+   * An iterator to the first item.
+   */
+  iterator begin() const;
+
+  /**
+   * A sentinel that compares equal to an iterator past the last item.
+   */
+  sentinel end() const;
+};
+
+/**
+ * Lazy view of consecutive batches of size items of a range. The last
+ * batch may be shorter. Each batch is gathered into a buffer owned by
+ * the iterator and reused, so no batch is allocated after the first.
+ * REQUIRES: R is iterable and outlives the view if it is an lvalue.
+ * THROWS: std::out_of_range if size is zero.
+ */
+template <typename R>
+class chunk_view {
+ private:
+  using base_iter = detail::view_iterator<R>;
+  using base_sent = detail::view_sentinel<R>;
+  using traits = std::iterator_traits<base_iter>;
+
+  std::conditional_t<std::is_lvalue_reference_v<R>, R,
+                     std::remove_reference_t<R>>
+      m_base;
+  const size_t m_size;
+
+ public:
+  chunk_view() = delete;
+
+  /**
+   * Chunk view should be passed the range and batch size.
+   */
+  chunk_view(R &&, size_t);
+
+  /**
+   * Marks the end of the view.
+   */
+  class sentinel {};
+
+  // Declare input iterators.
+  class iterator {
+    friend class chunk_view;
+
+   private:
+    base_iter m_current;
+    base_sent m_end;
+    size_t m_size;
+    std::vector<typename traits::value_type> m_batch;
+
+    /**
+     * Constructor that gathers the first batch.
+     */
+    iterator(base_iter, base_sent, size_t);
+
+    /**
+     * Replaces the batch with the next size items of the range.
+     */
+    void gather();
+
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::vector<typename traits::value_type>;
+    using difference_type = ptrdiff_t;
+    using pointer = const value_type *;
+    using reference = const value_type &;
+
+    iterator() = delete;
+
+    // Increment operator.
+
+    iterator &operator++();
+
+    // Dereference operator.
+
+    reference operator*() const;
+
+    // These iterators do not support arrow operators.
+
+    // Comparison operators. True at the end once the batch is empty.
+
+    bool operator==(const sentinel &) const;
+    bool operator!=(const sentinel &) const;
+  };
+
+  /**
+   * An iterator to the first batch.
+   */
+  iterator begin() const;
+
+  /**
+   * A sentinel that compares equal to an iterator past the last batch.
+   */
+  sentinel end() const;
+};
+
+/**
+ * Adaptor that keeps the items satisfying pred.
+ */
+template <typename Pred>
+detail::filter_closure<Pred> filter(Pred pred) {
+  return {std::move(pred)};
+}
+
+/**
+ * Adaptor that applies fn to every item.
+ */
+template <typename Function>
+detail::map_closure<Function> map(Function fn) {
+  return {std::move(fn)};
+}
+
+/**
+ * Adaptor that keeps at most the first count items.
+ */
+inline detail::take_closure take(size_t count) { return {count}; }
+
+/**
+ * Adaptor that groups items into batches of size.
+ */
+inline detail::chunk_closure chunk(size_t size) { return {size}; }
+
+// Pipe a range into an adaptor, as in range(n) | filter(pred) | map(fn).
+
+template <typename R, typename Pred>
+filter_view<R, Pred> operator|(R &&items,
+                               detail::filter_closure<Pred> adaptor) {
+  return filter_view<R, Pred>(std::forward<R>(items), std::move(adaptor.pred));
+}
+
+template <typename R, typename Function>
+map_view<R, Function> operator|(R &&items,
+                                detail::map_closure<Function> adaptor) {
+  return map_view<R, Function>(std::forward<R>(items), std::move(adaptor.fn));
+}
+
+template <typename R>
+take_view<R> operator|(R &&items, detail::take_closure adaptor) {
+  return take_view<R>(std::forward<R>(items), adaptor.count);
+}
+
+template <typename R>
+chunk_view<R> operator|(R &&items, detail::chunk_closure adaptor) {
+  return chunk_view<R>(std::forward<R>(items), adaptor.size);
+}
+
+// Constructed directly, views also refer to lvalues and own rvalues.
+
+template <typename R, typename Pred>
+filter_view(R &&, Pred) -> filter_view<R, Pred>;
+
+template <typename R, typename Function>
+map_view(R &&, Function) -> map_view<R, Function>;
+
+template <typename R>
+take_view(R &&, size_t) -> take_view<R>;
+
+template <typename R>
+chunk_view(R &&, size_t) -> chunk_view<R>;
+
+/* --- TEMPLATE IMPLEMENTATION --- */
+
+template <typename R, typename Pred>
+inline filter_view<R, Pred>::filter_view(R &&items, Pred pred)
+    : m_base(std::forward<R>(items)), m_pred(std::move(pred)) {}
+
+template <typename R, typename Pred>
+inline typename filter_view<R, Pred>::iterator filter_view<R, Pred>::begin()
+    const {
+  return iterator(this, std::begin(m_base), std::end(m_base));
+}
+
+template <typename R, typename Pred>
+inline typename filter_view<R, Pred>::sentinel filter_view<R, Pred>::end()
+    const {
+  return sentinel();
+}
+
+template <typename R, typename Pred>
+inline filter_view<R, Pred>::iterator::iterator(const filter_view *parent,
+                                                base_iter current,
+                                                base_sent stop)
+    : m_parent(parent), m_current(current), m_end(stop) {
+  satisfy();
+}
+
+template <typename R, typename Pred>
+inline void filter_view<R, Pred>::iterator::satisfy() {
+  while (m_current != m_end && !std::invoke(m_parent->m_pred, *m_current)) {
+    ++m_current;
+  }
+}
+
+template <typename R, typename Pred>
+inline typename filter_view<R, Pred>::iterator &
+filter_view<R, Pred>::iterator::operator++() {
+  ++m_current;
+  satisfy();
+  return *this;
+}
+
+template <typename R, typename Pred>
+inline typename filter_view<R, Pred>::iterator
+filter_view<R, Pred>::iterator::operator++(int) {
+  auto temp(*this);
+  this->operator++();
+  return temp;
+}
+
+template <typename R, typename Pred>
+inline typename filter_view<R, Pred>::iterator::reference
+    filter_view<R, Pred>::iterator::operator*() const {
+  return *m_current;
+}
+
+template <typename R, typename Pred>
+inline bool filter_view<R, Pred>::iterator::operator==(
+    const iterator &other) const {
+  return m_current == other.m_current;
+}
+
+template <typename R, typename Pred>
+inline bool filter_view<R, Pred>::iterator::operator!=(
+    const iterator &other) const {
+  return !(m_current == other.m_current);
+}
+
+template <typename R, typename Pred>
+inline bool filter_view<R, Pred>::iterator::operator==(const sentinel &) const {
+  return m_current == m_end;
+}
+
+template <typename R, typename Pred>
+inline bool filter_view<R, Pred>::iterator::operator!=(const sentinel &) const {
+  return m_current != m_end;
+}
+
+template <typename R, typename Function>
+inline map_view<R, Function>::map_view(R &&items, Function fn)
+    : m_base(std::forward<R>(items)), m_fn(std::move(fn)) {}
+
+template <typename R, typename Function>
+inline typename map_view<R, Function>::iterator map_view<R, Function>::begin()
+    const {
+  return iterator(this, std::begin(m_base));
+}
+
+template <typename R, typename Function>
+inline typename map_view<R, Function>::sentinel map_view<R, Function>::end()
+    const {
+  return sentinel(std::end(m_base));
+}
+
+template <typename R, typename Function>
+inline map_view<R, Function>::sentinel::sentinel(base_sent stop)
+    : m_end(stop) {}
+
+template <typename R, typename Function>
+inline map_view<R, Function>::iterator::iterator(const map_view *parent,
+                                                 base_iter current)
+    : m_parent(parent), m_current(current) {}
+
+template <typename R, typename Function>
+inline typename map_view<R, Function>::iterator &
+map_view<R, Function>::iterator::operator++() {
+  ++m_current;
+  return *this;
+}
+
+template <typename R, typename Function>
+inline typename map_view<R, Function>::iterator
+map_view<R, Function>::iterator::operator++(int) {
+  auto temp(*this);
+  ++m_current;
+  return temp;
+}
+
+template <typename R, typename Function>
+inline typename map_view<R, Function>::iterator::reference
+    map_view<R, Function>::iterator::operator*() const {
+  return std::invoke(m_parent->m_fn, *m_current);
+}
+
+template <typename R, typename Function>
+inline bool map_view<R, Function>::iterator::operator==(
+    const iterator &other) const {
+  return m_current == other.m_current;
+}
+
+template <typename R, typename Function>
+inline bool map_view<R, Function>::iterator::operator!=(
+    const iterator &other) const {
+  return !(m_current == other.m_current);
+}
+
+template <typename R, typename Function>
+inline bool map_view<R, Function>::iterator::operator==(
+    const sentinel &stop) const {
+  return m_current == stop.m_end;
+}
+
+template <typename R, typename Function>
+inline bool map_view<R, Function>::iterator::operator!=(
+    const sentinel &stop) const {
+  return m_current != stop.m_end;
+}
+
+template <typename R>
+inline take_view<R>::take_view(R &&items, size_t count)
+    : m_base(std::forward<R>(items)), m_count(count) {}
+
+template <typename R>
+inline typename take_view<R>::iterator take_view<R>::begin() const {
+  return iterator(std::begin(m_base), m_count);
+}
+
+template <typename R>
+inline typename take_view<R>::sentinel take_view<R>::end() const {
+  return sentinel(std::end(m_base));
+}
+
+template <typename R>
+inline take_view<R>::sentinel::sentinel(base_sent stop) : m_end(stop) {}
+
+template <typename R>
+inline take_view<R>::iterator::iterator(base_iter current, size_t remaining)
+    : m_current(current), m_remaining(remaining) {}
+
+template <typename R>
+inline typename take_view<R>::iterator &take_view<R>::iterator::operator++() {
+  ++m_current;
+  --m_remaining;
+  return *this;
+}
+
+template <typename R>
+inline typename take_view<R>::iterator take_view<R>::iterator::operator++(int) {
+  auto temp(*this);
+  this->operator++();
+  return temp;
+}
+
+template <typename R>
+inline typename take_view<R>::iterator::reference
+    take_view<R>::iterator::operator*() const {
+  return *m_current;
+}
+
+template <typename R>
+inline bool take_view<R>::iterator::operator==(const iterator &other) const {
+  return m_current == other.m_current;
+}
+
+template <typename R>
+inline bool take_view<R>::iterator::operator!=(const iterator &other) const {
+  return !(m_current == other.m_current);
+}
+
+template <typename R>
+inline bool take_view<R>::iterator::operator==(const sentinel &stop) const {
+  return m_remaining == 0 || m_current == stop.m_end;
+}
+
+template <typename R>
+inline bool take_view<R>::iterator::operator!=(const sentinel &stop) const {
+  return !(*this == stop);
+}
+
+template <typename R>
+inline chunk_view<R>::chunk_view(R &&items, size_t size)
+    : m_base(std::forward<R>(items)), m_size(size) {
+  if (size == 0) throw std::out_of_range("Chunk size must be non-zero.");
+}
+
+template <typename R>
+inline typename chunk_view<R>::iterator chunk_view<R>::begin() const {
+  return iterator(std::begin(m_base), std::end(m_base), m_size);
+}
+
+template <typename R>
+inline typename chunk_view<R>::sentinel chunk_view<R>::end() const {
+  return sentinel();
+}
+
+template <typename R>
+inline chunk_view<R>::iterator::iterator(base_iter current, base_sent stop,
+                                         size_t size)
+    : m_current(current), m_end(stop), m_size(size) {
+  m_batch.reserve(size);
+  gather();
+}
+
+template <typename R>
+inline void chunk_view<R>::iterator::gather() {
+  m_batch.clear();
+  for (; m_batch.size() < m_size && m_current != m_end; ++m_current) {
+    m_batch.emplace_back(*m_current);
+  }
+}
+
+template <typename R>
+inline typename chunk_view<R>::iterator &chunk_view<R>::iterator::operator++() {
+  gather();
+  return *this;
+}
+
+template <typename R>
+inline typename chunk_view<R>::iterator::reference
+    chunk_view<R>::iterator::operator*() const {
+  return m_batch;
+}
+
+template <typename R>
+inline bool chunk_view<R>::iterator::operator==(const sentinel &) const {
+  return m_batch.empty();
+}
+
+template <typename R>
+inline bool chunk_view<R>::iterator::operator!=(const sentinel &) const {
+  return !m_batch.empty();
+}
@@ -6,18 +6,72 @@ Python-like cartesian product iteration for two containers.
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
 #include <iterator>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+namespace detail {
+
+/**
+ * Bounds of the block of pairs a tiled product iterator is visiting.
+ * Row-major iterators find the bounds of a row through their product,
+ * so they carry nothing at all.
+ */
+template <typename Iter1, typename Iter2, bool Tiled>
+struct product_tile {};
+
+template <typename Iter1, typename Iter2>
+struct product_tile<Iter1, Iter2, true> {
+  Iter1 c1_tile_begin;
+  Iter1 c1_tile_end;
+  Iter2 c2_tile_begin;
+  Iter2 c2_tile_end;
+};
+
+}  // namespace detail
 
 /**
- * Templated product class for read-only cartesian product iteration.
+ * Templated product class for cartesian product iteration.
+ * Dereferencing yields a pair of references into the containers.
+ * Const containers are read-only, while non-const containers can be
+ * written through the product.
+ *
+ * By default, pairs are visited in row-major order. Given a tile size,
+ * the product is Tiled and visits pairs in tile x tile blocks instead,
+ * so that both blocks of items stay in cache while every pair between
+ * them is visited. Only tiled iterators carry the bounds of a block.
+ * Random access containers give random access iterators, which allow
+ * the pair space to be partitioned.
  * REQUIRES: C1 and C2 are forward_iterable.
  */
-template <typename C1, typename C2>
+template <typename C1, typename C2, bool Tiled = false>
 class product {
  private:
-  const C1 &container_1;
-  const C2 &container_2;
+  C1 &container_1;
+  C2 &container_2;
+
+  /**
+   * Side length of a block of pairs. 0 means one block for everything.
+   */
+  const size_t tile;
+
+  using iter_1 = decltype(std::begin(std::declval<C1 &>()));
+  using iter_2 = decltype(std::begin(std::declval<C2 &>()));
+
+  static constexpr bool is_random_access =
+      std::is_base_of_v<
+          std::random_access_iterator_tag,
+          typename std::iterator_traits<iter_1>::iterator_category> &&
+      std::is_base_of_v<
+          std::random_access_iterator_tag,
+          typename std::iterator_traits<iter_2>::iterator_category>;
 
  public:
   product() = delete;
@@ -25,32 +79,84 @@ class product {
   /**
    * Product should be passed the two containers to iterate over.
    */
-  product(const C1 &, const C2 &);
-
-  class iterator
-      : public std::iterator<
-            std::forward_iterator_tag,
-            std::pair<typename C1::value_type, typename C2::value_type>,
-            ptrdiff_t,
-            const std::pair<typename C1::value_type, typename C2::value_type> *,
-            const std::pair<typename C1::value_type, typename C2::value_type>
-                &> {
+  product(C1 &, C2 &);
+
+  /**
+   * Tiled product should also be passed the side length of the blocks
+   * to visit pairs in. REQUIRES: Tiled.
+   */
+  product(C1 &, C2 &, size_t);
+
+  /**
+   * Marks the end of the product, which is one past the last row.
+   */
+  class sentinel {
     friend class product;
 
    private:
-    typename C2::const_iterator c2_begin;
-    typename C2::const_iterator c2_end;
-
-    typename C1::const_iterator c1_current;
-    typename C2::const_iterator c2_current;
+    iter_1 stop;
+    iter_2 restart;
 
     /**
      * Constructor that gives parameters.
      */
-    explicit iterator(typename C2::const_iterator, typename C2::const_iterator,
-                      typename C1::const_iterator, typename C2::const_iterator);
+    sentinel(iter_1, iter_2);
 
    public:
+    sentinel() = delete;
+  };
+
+  class iterator : private detail::product_tile<iter_1, iter_2, Tiled> {
+    friend class product;
+
+   private:
+    const product *parent;
+
+    iter_1 c1_current;
+    iter_2 c2_current;
+
+    /**
+     * Constructor that starts at the first pair.
+     */
+    explicit iterator(const product *);
+
+    /**
+     * Constructor for the end, which is one past the last row. It takes
+     * no tile steps, so building the end is cheap for any container.
+     */
+    iterator(const product *, iter_1, iter_2);
+
+    /**
+     * Returns iter advanced by the tile size, but no further than stop.
+     */
+    template <typename Iter>
+    Iter tile_after(Iter iter, Iter stop) const;
+
+    /**
+     * Moves to the pair at the given position in visiting order.
+     * REQUIRES: random access containers.
+     */
+    void seek(size_t);
+
+    /**
+     * Position of the current pair in visiting order.
+     * REQUIRES: random access containers.
+     */
+    size_t position() const;
+
+   public:
+    using iterator_category =
+        std::conditional_t<is_random_access, std::random_access_iterator_tag,
+                           std::forward_iterator_tag>;
+    using value_type =
+        std::pair<typename std::iterator_traits<iter_1>::value_type,
+                  typename std::iterator_traits<iter_2>::value_type>;
+    using difference_type = ptrdiff_t;
+    using pointer = void;
+    using reference =
+        std::pair<typename std::iterator_traits<iter_1>::reference,
+                  typename std::iterator_traits<iter_2>::reference>;
+
     iterator() = delete;
 
     // Increment operator.
@@ -58,17 +164,44 @@ class product {
     iterator &operator++();
     iterator operator++(int);
 
+    // Decrement operator. REQUIRES: random access containers.
+
+    iterator &operator--();
+    iterator operator--(int);
+
+    // Random access operators. REQUIRES: random access containers.
+
+    iterator &operator+=(ptrdiff_t);
+    iterator &operator-=(ptrdiff_t);
+    iterator operator+(ptrdiff_t) const;
+    iterator operator-(ptrdiff_t) const;
+    ptrdiff_t operator-(const iterator &) const;
+    reference operator[](ptrdiff_t) const;
+
+    friend iterator operator+(ptrdiff_t n, const iterator &it) {
+      return it + n;
+    }
+
     // Dereference operator.
 
-    std::pair<typename C1::value_type, typename C2::value_type> operator*()
-        const;
+    reference operator*() const;
 
     // These iterators do not support arrow operators.
 
-    // Comparison operators.
+    // Comparison operators. The second container moves on every step,
+    // so it is compared first and usually settles the comparison alone.
 
     bool operator==(const iterator &) const;
     bool operator!=(const iterator &) const;
+    bool operator<(const iterator &) const;
+    bool operator>(const iterator &) const;
+    bool operator<=(const iterator &) const;
+    bool operator>=(const iterator &) const;
+
+    // Comparison against the end, second container first like above.
+
+    bool operator==(const sentinel &) const;
+    bool operator!=(const sentinel &) const;
   };
 
   /**
@@ -77,68 +210,408 @@ class product {
   iterator begin() const;
 
   /**
-   * An iterator to one past the last pair.
+   * A sentinel that compares equal to an iterator past the last pair.
    */
-  iterator end() const;
+  sentinel end() const;
+
+  /**
+   * The number of pairs in the product.
+   */
+  size_t size() const;
 };
 
+// A tile size makes the product tiled.
+template <typename C1, typename C2>
+product(C1 &, C2 &, size_t) -> product<C1, C2, true>;
+
 /* --- TEMPLATE IMPLEMENTATION --- */
 
-template <typename C1, typename C2>
-inline product<C1, C2>::product(const C1 &c1, const C2 &c2)
-    : container_1(c1), container_2(c2) {}
+template <typename C1, typename C2, bool Tiled>
+inline product<C1, C2, Tiled>::product(C1 &c1, C2 &c2)
+    : container_1(c1), container_2(c2), tile(0) {}
 
-template <typename C1, typename C2>
-inline typename product<C1, C2>::iterator product<C1, C2>::begin() const {
-  return iterator(container_2.cbegin(), container_2.cend(),
-                  container_1.cbegin(), container_2.cbegin());
+template <typename C1, typename C2, bool Tiled>
+inline product<C1, C2, Tiled>::product(C1 &c1, C2 &c2, size_t tile_size)
+    : container_1(c1), container_2(c2), tile(tile_size) {
+  static_assert(Tiled, "Only tiled products take a tile size.");
 }
 
-template <typename C1, typename C2>
-inline typename product<C1, C2>::iterator product<C1, C2>::end() const {
-  return iterator(container_2.cbegin(), container_2.cend(), container_1.cend(),
-                  container_2.cbegin());
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator
+product<C1, C2, Tiled>::begin() const {
+  // With either container empty there are no pairs at all.
+  if (std::begin(container_1) == std::end(container_1) ||
+      std::begin(container_2) == std::end(container_2)) {
+    return iterator(this, std::end(container_1), std::begin(container_2));
+  }
+  return iterator(this);
 }
 
-template <typename C1, typename C2>
-inline product<C1, C2>::iterator::iterator(typename C2::const_iterator c2_b,
-                                           typename C2::const_iterator c2_e,
-                                           typename C1::const_iterator c1_c,
-                                           typename C2::const_iterator c2_c)
-    : c2_begin(c2_b), c2_end(c2_e), c1_current(c1_c), c2_current(c2_c) {}
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::sentinel product<C1, C2, Tiled>::end()
+    const {
+  return sentinel(std::end(container_1), std::begin(container_2));
+}
 
-template <typename C1, typename C2>
-inline typename product<C1, C2>::iterator &product<C1, C2>::iterator::
-operator++() {
-  if (++c2_current == c2_end) {
-    c2_current = c2_begin;
+template <typename C1, typename C2, bool Tiled>
+inline size_t product<C1, C2, Tiled>::size() const {
+  return std::size(container_1) * std::size(container_2);
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline product<C1, C2, Tiled>::sentinel::sentinel(iter_1 stop_in,
+                                                  iter_2 restart_in)
+    : stop(stop_in), restart(restart_in) {}
+
+template <typename C1, typename C2, bool Tiled>
+inline product<C1, C2, Tiled>::iterator::iterator(const product *parent_in)
+    : parent(parent_in),
+      c1_current(std::begin(parent->container_1)),
+      c2_current(std::begin(parent->container_2)) {
+  if constexpr (Tiled) {
+    this->c1_tile_begin = c1_current;
+    this->c1_tile_end = tile_after(c1_current, std::end(parent->container_1));
+    this->c2_tile_begin = c2_current;
+    this->c2_tile_end = tile_after(c2_current, std::end(parent->container_2));
+  }
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline product<C1, C2, Tiled>::iterator::iterator(const product *parent_in,
+                                                  iter_1 c1_end,
+                                                  iter_2 c2_begin)
+    : parent(parent_in), c1_current(c1_end), c2_current(c2_begin) {
+  if constexpr (Tiled) {
+    this->c1_tile_begin = this->c1_tile_end = c1_end;
+    this->c2_tile_begin = this->c2_tile_end = c2_begin;
+  }
+}
+
+template <typename C1, typename C2, bool Tiled>
+template <typename Iter>
+inline Iter product<C1, C2, Tiled>::iterator::tile_after(Iter iter,
+                                                         Iter stop) const {
+  if (parent->tile == 0) return stop;
+  if constexpr (is_random_access) {
+    const auto remaining = static_cast<size_t>(stop - iter);
+    return iter + static_cast<ptrdiff_t>(std::min(parent->tile, remaining));
+  } else {
+    for (size_t i = 0; i < parent->tile && iter != stop; ++i) ++iter;
+    return iter;
+  }
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline void product<C1, C2, Tiled>::iterator::seek(size_t pos) {
+  const auto c1_begin = std::begin(parent->container_1);
+  const auto c2_begin = std::begin(parent->container_2);
+  const auto n1 = std::size(parent->container_1);
+  const auto n2 = std::size(parent->container_2);
+  if (pos >= n1 * n2) {
+    *this = iterator(parent, std::end(parent->container_1), c2_begin);
+    return;
+  }
+  if constexpr (!Tiled) {
+    c1_current = c1_begin + static_cast<ptrdiff_t>(pos / n2);
+    c2_current = c2_begin + static_cast<ptrdiff_t>(pos % n2);
+  } else {
+    const auto rows = parent->tile ? parent->tile : n1;
+    const auto cols = parent->tile ? parent->tile : n2;
+    // Find the band of rows, then the block within it, then the pair.
+    const auto band_begin = pos / (rows * n2) * rows;
+    const auto band_rows = std::min(rows, n1 - band_begin);
+    const auto in_band = pos - band_begin * n2;
+    const auto block_begin = in_band / (band_rows * cols) * cols;
+    const auto block_cols = std::min(cols, n2 - block_begin);
+    const auto in_block = in_band - block_begin * band_rows;
+
+    this->c1_tile_begin = c1_begin + static_cast<ptrdiff_t>(band_begin);
+    this->c1_tile_end = this->c1_tile_begin + static_cast<ptrdiff_t>(band_rows);
+    this->c2_tile_begin = c2_begin + static_cast<ptrdiff_t>(block_begin);
+    this->c2_tile_end =
+        this->c2_tile_begin + static_cast<ptrdiff_t>(block_cols);
+    c1_current =
+        this->c1_tile_begin + static_cast<ptrdiff_t>(in_block / block_cols);
+    c2_current =
+        this->c2_tile_begin + static_cast<ptrdiff_t>(in_block % block_cols);
+  }
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline size_t product<C1, C2, Tiled>::iterator::position() const {
+  const auto n2 = std::size(parent->container_2);
+  const auto c1_begin = std::begin(parent->container_1);
+  const auto c2_begin = std::begin(parent->container_2);
+  const auto row = static_cast<size_t>(c1_current - c1_begin);
+  const auto col = static_cast<size_t>(c2_current - c2_begin);
+  if constexpr (!Tiled) {
+    return row * n2 + col;
+  } else {
+    // The end is one past the last row, outside of any block.
+    if (c1_current == std::end(parent->container_1)) return row * n2 + col;
+    const auto band_begin = static_cast<size_t>(this->c1_tile_begin - c1_begin);
+    const auto band_rows =
+        static_cast<size_t>(this->c1_tile_end - this->c1_tile_begin);
+    const auto block_begin =
+        static_cast<size_t>(this->c2_tile_begin - c2_begin);
+    const auto block_cols =
+        static_cast<size_t>(this->c2_tile_end - this->c2_tile_begin);
+    return band_begin * n2 + block_begin * band_rows +
+           (row - band_begin) * block_cols + (col - block_begin);
+  }
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator &
+product<C1, C2, Tiled>::iterator::operator++() {
+  if constexpr (!Tiled) {
+    if (++c2_current != std::end(parent->container_2)) return *this;
+    c2_current = std::begin(parent->container_2);
     ++c1_current;
+  } else {
+    const auto c2_end = std::end(parent->container_2);
+    if (++c2_current != this->c2_tile_end) return *this;
+    c2_current = this->c2_tile_begin;
+    if (++c1_current != this->c1_tile_end) return *this;
+    // Finished a block, so move to the next block in the band.
+    c1_current = this->c1_tile_begin;
+    if (this->c2_tile_end != c2_end) {
+      c2_current = this->c2_tile_begin = this->c2_tile_end;
+      this->c2_tile_end = tile_after(this->c2_tile_begin, c2_end);
+      return *this;
+    }
+    // Finished a band, so move to the first block of the next band.
+    c1_current = this->c1_tile_begin = this->c1_tile_end;
+    this->c1_tile_end =
+        tile_after(this->c1_tile_begin, std::end(parent->container_1));
+    c2_current = this->c2_tile_begin = std::begin(parent->container_2);
+    this->c2_tile_end = tile_after(this->c2_tile_begin, c2_end);
   }
   return *this;
 }
 
-template <typename C1, typename C2>
-inline typename product<C1, C2>::iterator product<C1, C2>::iterator::operator++(
-    int) {
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator
+product<C1, C2, Tiled>::iterator::operator++(int) {
   auto temp(*this);
   this->operator++();
   return temp;
 }
 
-template <typename C1, typename C2>
-inline std::pair<typename C1::value_type, typename C2::value_type>
-    product<C1, C2>::iterator::operator*() const {
-  return std::make_pair(*c1_current, *c2_current);
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator &
+product<C1, C2, Tiled>::iterator::operator--() {
+  return this->operator+=(-1);
 }
 
-template <typename C1, typename C2>
-inline bool product<C1, C2>::iterator::operator==(
-    const typename product<C1, C2>::iterator &other) const {
-  return c1_current == other.c1_current && c2_current == other.c2_current;
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator
+product<C1, C2, Tiled>::iterator::operator--(int) {
+  auto temp(*this);
+  this->operator--();
+  return temp;
 }
 
-template <typename C1, typename C2>
-inline bool product<C1, C2>::iterator::operator!=(
-    const typename product<C1, C2>::iterator &other) const {
-  return c1_current != other.c1_current || c2_current != other.c2_current;
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator &
+product<C1, C2, Tiled>::iterator::operator+=(ptrdiff_t n) {
+  seek(position() + static_cast<size_t>(n));
+  return *this;
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator &
+product<C1, C2, Tiled>::iterator::operator-=(ptrdiff_t n) {
+  return this->operator+=(-n);
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator
+product<C1, C2, Tiled>::iterator::operator+(ptrdiff_t n) const {
+  auto temp(*this);
+  return temp += n;
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator
+product<C1, C2, Tiled>::iterator::operator-(ptrdiff_t n) const {
+  auto temp(*this);
+  return temp -= n;
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline ptrdiff_t product<C1, C2, Tiled>::iterator::operator-(
+    const typename product<C1, C2, Tiled>::iterator &other) const {
+  return static_cast<ptrdiff_t>(position() - other.position());
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator::reference
+    product<C1, C2, Tiled>::iterator::operator[](ptrdiff_t n) const {
+  return *(*this + n);
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline typename product<C1, C2, Tiled>::iterator::reference
+    product<C1, C2, Tiled>::iterator::operator*() const {
+  return reference(*c1_current, *c2_current);
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline bool product<C1, C2, Tiled>::iterator::operator==(
+    const typename product<C1, C2, Tiled>::iterator &other) const {
+  return c2_current == other.c2_current && c1_current == other.c1_current;
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline bool product<C1, C2, Tiled>::iterator::operator!=(
+    const typename product<C1, C2, Tiled>::iterator &other) const {
+  return c2_current != other.c2_current || c1_current != other.c1_current;
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline bool product<C1, C2, Tiled>::iterator::operator<(
+    const typename product<C1, C2, Tiled>::iterator &other) const {
+  return position() < other.position();
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline bool product<C1, C2, Tiled>::iterator::operator>(
+    const typename product<C1, C2, Tiled>::iterator &other) const {
+  return other < *this;
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline bool product<C1, C2, Tiled>::iterator::operator<=(
+    const typename product<C1, C2, Tiled>::iterator &other) const {
+  return !(other < *this);
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline bool product<C1, C2, Tiled>::iterator::operator>=(
+    const typename product<C1, C2, Tiled>::iterator &other) const {
+  return !(*this < other);
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline bool product<C1, C2, Tiled>::iterator::operator==(
+    const typename product<C1, C2, Tiled>::sentinel &last) const {
+  return c2_current == last.restart && c1_current == last.stop;
+}
+
+template <typename C1, typename C2, bool Tiled>
+inline bool product<C1, C2, Tiled>::iterator::operator!=(
+    const typename product<C1, C2, Tiled>::sentinel &last) const {
+  return c2_current != last.restart || c1_current != last.stop;
+}
+
+namespace detail {
+
+/**
+ * The positions [next, stop) of a product still owned by one worker.
+ * The owner takes small blocks from the front, while idle workers
+ * steal half of what remains from the back.
+ */
+struct product_share {
+  std::mutex lock;
+  size_t next = 0;
+  size_t stop = 0;
+
+  /**
+   * Takes up to grain positions from the front into [first, last).
+   */
+  bool take(size_t grain, size_t &first, size_t &last) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (next == stop) return false;
+    first = next;
+    last = next = std::min(stop, next + grain);
+    return true;
+  }
+
+  /**
+   * Moves the back half of the positions left in victim into this.
+   */
+  bool steal(product_share &victim) {
+    size_t first, last;
+    {
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (victim.next == victim.stop) return false;
+      first = victim.next + (victim.stop - victim.next) / 2;
+      last = victim.stop;
+      victim.stop = first;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    next = first;
+    stop = last;
+    return true;
+  }
+};
+
+}  // namespace detail
+
+/**
+ * Calls fn on every pair of the product using a pool of threads.
+ * The pairs are split evenly across threads in visiting order, and
+ * threads that run out of work steal from the others, so that uneven
+ * costs of fn do not leave threads idle.
+ * REQUIRES: C1 and C2 are random access.
+ * THROWS: The first exception thrown by fn, once every thread stops,
+ * or std::system_error if a thread cannot be started.
+ */
+template <typename C1, typename C2, bool Tiled, typename Function>
+void parallel_for_each(const product<C1, C2, Tiled> &prod, Function fn,
+                       unsigned threads = std::thread::hardware_concurrency()) {
+  using category =
+      typename product<C1, C2, Tiled>::iterator::iterator_category;
+  static_assert(std::is_same_v<category, std::random_access_iterator_tag>,
+                "Partitioning a product requires random access containers.");
+  const auto total = prod.size();
+  const auto workers =
+      std::max<size_t>(1, std::min<size_t>(threads ? threads : 1, total));
+  // Blocks small enough to balance, but large enough to rarely lock.
+  const auto grain = std::max<size_t>(1, total / (workers * 64));
+
+  std::vector<detail::product_share> shares(workers);
+  for (size_t i = 0; i < workers; ++i) {
+    shares[i].next = total * i / workers;
+    shares[i].stop = total * (i + 1) / workers;
+  }
+
+  std::atomic<bool> failed(false);
+  std::exception_ptr failure;
+  std::mutex failure_lock;
+
+  auto work = [&](size_t self) {
+    try {
+      auto &own = shares[self];
+      for (size_t victim = 1;;) {
+        size_t first, last;
+        while (!failed && own.take(grain, first, last)) {
+          auto iter = prod.begin() + static_cast<ptrdiff_t>(first);
+          for (auto pos = first; pos < last; ++pos, ++iter) fn(*iter);
+        }
+        if (failed || victim == workers) break;
+        // Out of work, so look for another worker to steal from.
+        if (!own.steal(shares[(self + victim) % workers])) ++victim;
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> guard(failure_lock);
+      if (!failure) failure = std::current_exception();
+      failed = true;
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(workers - 1);
+  try {
+    for (size_t i = 1; i < workers; ++i) pool.emplace_back(work, i);
+  } catch (...) {
+    // Destroying a joinable thread would terminate the program.
+    failed = true;
+    for (auto &worker : pool) worker.join();
+    throw;
+  }
+  work(0);
+  for (auto &worker : pool) worker.join();
+  if (failure) std::rethrow_exception(failure);
 }
@@ -1,156 +1,495 @@
 /*
 Copyright 2020. Siwei Wang.
 
-Iteration over a range of consecutive numbers.
+Iteration over a range of evenly spaced numbers.
 */
 #pragma once
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+namespace detail {
+
+/**
+ * Types of the steps of a range over T. Floating point numbers cannot
+ * be template arguments, so floating point ranges always take their
+ * step at runtime, and their compile time step can only be 0.
+ */
+template <typename T, bool = std::is_floating_point_v<T>>
+struct range_step_types {
+  using fixed = std::make_signed_t<T>;
+  using runtime = std::make_signed_t<T>;
+};
+
+template <typename T>
+struct range_step_types<T, true> {
+  using fixed = std::intmax_t;
+  using runtime = T;
+};
+
+template <typename T>
+using range_fixed_step_t = typename range_step_types<T>::fixed;
+
+/**
+ * Holds the step of a range. A non-zero Step is fixed at compile time
+ * and takes no space, while Step = 0 stores the step at runtime.
+ */
+template <typename S, auto Step, bool = Step == 0>
+class range_step {
+ protected:
+  constexpr explicit range_step(S) {}
+  constexpr S step() const { return Step; }
+};
+
+template <typename S, auto Step>
+class range_step<S, Step, true> {
+ private:
+  S m_step;
+
+ protected:
+  constexpr explicit range_step(S step_in) : m_step(step_in) {}
+  constexpr S step() const { return m_step; }
+};
+
+/**
+ * Holds the first item of a floating point range. Adding up steps would
+ * let rounding errors build up, so its items are computed from the
+ * first one instead. Integer ranges count the items themselves.
+ */
+template <typename T, bool = std::is_floating_point_v<T>>
+class range_origin {
+ protected:
+  constexpr explicit range_origin(T) {}
+  constexpr T origin() const { return 0; }
+};
 
 template <typename T>
-class range {
+class range_origin<T, true> {
  private:
-  const T m_start;
-  const T m_stop;
+  T m_origin;
+
+ protected:
+  constexpr explicit range_origin(T origin_in) : m_origin(origin_in) {}
+  constexpr T origin() const { return m_origin; }
+};
+
+/**
+ * Returns base + count * step. Computed with unsigned wraparound so
+ * that no intermediate value can overflow.
+ */
+template <typename C, typename S>
+constexpr C wrapping_advance(C base, ptrdiff_t count, S step) {
+  return static_cast<C>(static_cast<std::uintmax_t>(base) +
+                        static_cast<std::uintmax_t>(count) *
+                            static_cast<std::uintmax_t>(step));
+}
+
+/**
+ * Signed distance from first to last. Computed with unsigned
+ * wraparound so that no intermediate value can overflow.
+ */
+template <typename T>
+constexpr ptrdiff_t signed_distance(T first, T last) {
+  return static_cast<ptrdiff_t>(static_cast<std::uintmax_t>(last) -
+                                static_cast<std::uintmax_t>(first));
+}
+
+}  // namespace detail
+
+/**
+ * Templated range class for iteration over evenly spaced numbers.
+ * A non-zero Step fixes the step at compile time. Otherwise, the step
+ * is chosen at runtime, which floating point ranges always do.
+ */
+template <typename T, detail::range_fixed_step_t<T> Step = 0>
+class range
+    : private detail::range_step<typename detail::range_step_types<T>::runtime,
+                                 Step>,
+      private detail::range_origin<T> {
+  static_assert((std::is_integral_v<T> && !std::is_same_v<T, bool>) ||
+                std::is_floating_point_v<T>);
+  static_assert(std::is_integral_v<T> || Step == 0,
+                "Floating point steps are only chosen at runtime.");
+
+ public:
+  using step_type = typename detail::range_step_types<T>::runtime;
+
+ private:
+  using step_base = detail::range_step<step_type, Step>;
+  using origin_base = detail::range_origin<T>;
+
+  static constexpr bool is_floating = std::is_floating_point_v<T>;
+
+  /**
+   * Integer items are tracked in the widest integer of the same
+   * signedness, so that stepping one past the last item can never wrap
+   * around. Floating point items are tracked by their index.
+   */
+  using counter_type = std::conditional_t<
+      is_floating, ptrdiff_t,
+      std::conditional_t<std::is_signed_v<T>, std::intmax_t, std::uintmax_t>>;
+
+  const counter_type m_start;
+
+  /**
+   * The value one step past the last item in the range.
+   */
+  const counter_type m_stop;
+
+  /**
+   * Resolves the counter of the first item given a Python start.
+   */
+  static constexpr counter_type resolve_start(T start);
+
+  /**
+   * Resolves the counter one step past the last item given a Python stop.
+   * THROWS: std::out_of_range if a floating point range is too long.
+   */
+  constexpr counter_type resolve_stop(T start, T stop) const;
 
  public:
   range() = delete;
 
   /**
-   * Represents range [0, stop), possibly reversed.
+   * Represents range [0, stop). With a runtime step,
+   * the range is reversed if stop is negative.
+   * THROWS: std::out_of_range if a floating point range is too long.
+   */
+  constexpr explicit range(T stop);
+
+  /**
+   * Represents range [start, stop). With a runtime step,
+   * the range is reversed if start is greater than stop.
+   * THROWS: std::out_of_range if a floating point range is too long.
    */
-  explicit range(T stop);
+  constexpr explicit range(T start, T stop);
 
   /**
-   * Represents range [start, stop), possibly reversed.
+   * Represents range [start, stop) with the given step,
+   * following Python semantics. Only valid with a runtime step.
+   * Floating point ranges have ceil((stop - start) / step) items.
+   * THROWS: std::out_of_range if step is zero, or if a floating point
+   * range is too long.
    */
-  explicit range(T start, T stop);
+  constexpr explicit range(T start, T stop, step_type step);
 
   /**
-   * Bidirectional iterators on range.
+   * Random access iterators on range.
    */
-  class iterator : public std::iterator<std::bidirectional_iterator_tag, T,
-                                        ptrdiff_t, const T *, const T &> {
+  class iterator : private step_base, private origin_base {
     friend class range;
 
    private:
     /**
      * Current location of this iterator.
      */
-    T m_current;
+    counter_type m_current;
 
     /**
-     * Stops when compares current false.
-     */
-    const T m_limit;
-
-    /**
-     * Determines whether the direction of iteration
-     * is forward (++) or backward (--).
+     * All argument constructor used by range.
      */
-    const bool is_forward;
+    constexpr iterator(counter_type current, step_type step, T origin);
 
     /**
-     * All argument constructor used by range.
+     * Moves the iterator n items along.
      */
-    iterator(T current, T limit, bool direction);
+    constexpr void advance(ptrdiff_t n);
 
    public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = ptrdiff_t;
+    using pointer = const T *;
+    using reference = T;
+
     iterator() = delete;
 
     // Increment operator.
 
-    iterator &operator++();
-    iterator operator++(int);
+    constexpr iterator &operator++();
+    constexpr iterator operator++(int);
 
     // Decrement operator.
 
-    iterator &operator--();
-    iterator operator--(int);
+    constexpr iterator &operator--();
+    constexpr iterator operator--(int);
+
+    // Random access operators.
+
+    constexpr iterator &operator+=(ptrdiff_t);
+    constexpr iterator &operator-=(ptrdiff_t);
+    constexpr iterator operator+(ptrdiff_t) const;
+    constexpr iterator operator-(ptrdiff_t) const;
+    constexpr ptrdiff_t operator-(const iterator &) const;
+    constexpr T operator[](ptrdiff_t) const;
+
+    friend constexpr iterator operator+(ptrdiff_t n, const iterator &iter) {
+      return iter + n;
+    }
 
     // Dereference operator.
 
-    T operator*() const;
+    constexpr T operator*() const;
 
     // These iterators do not support arrow operators.
 
     // Comparison operators.
 
-    bool operator==(const iterator &) const;
-    bool operator!=(const iterator &) const;
+    constexpr bool operator==(const iterator &) const;
+    constexpr bool operator!=(const iterator &) const;
+    constexpr bool operator<(const iterator &) const;
+    constexpr bool operator>(const iterator &) const;
+    constexpr bool operator<=(const iterator &) const;
+    constexpr bool operator>=(const iterator &) const;
   };
 
   /**
    * An iterator to the first item in the range.
    */
-  iterator begin() const;
+  constexpr iterator begin() const;
 
   /**
    * An iterator to one past the last item in the range.
    */
-  iterator end() const;
+  constexpr iterator end() const;
+
+  /**
+   * The step between consecutive items in the range.
+   */
+  constexpr step_type step() const;
+
+  /**
+   * The number of items in the range.
+   */
+  constexpr size_t size() const;
+
+  /**
+   * The item at the given position in the range.
+   */
+  constexpr T operator[](size_t) const;
 };
 
-template <typename T>
-inline range<T>::range(T stop) : range(0, stop) {}
+/* --- TEMPLATE IMPLEMENTATION --- */
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr range<T, Step>::range(T stop) : range(0, stop) {}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr range<T, Step>::range(T start, T stop)
+    : step_base(Step != 0 ? static_cast<step_type>(Step)
+                          : static_cast<step_type>(start <= stop ? 1 : -1)),
+      origin_base(start),
+      m_start(resolve_start(start)),
+      m_stop(resolve_stop(start, stop)) {}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr range<T, Step>::range(T start, T stop, step_type step_in)
+    : step_base(step_in),
+      origin_base(start),
+      m_start(resolve_start(start)),
+      m_stop(resolve_stop(start, stop)) {
+  static_assert(Step == 0, "Step is already fixed at compile time.");
+}
 
-template <typename T>
-inline range<T>::range(T start, T stop) : m_start(start), m_stop(stop) {}
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::counter_type range<T, Step>::resolve_start(
+    T start) {
+  if constexpr (is_floating) {
+    return 0;
+  } else {
+    return start;
+  }
+}
 
-template <typename T>
-inline typename range<T>::iterator range<T>::begin() const {
-  return iterator(m_start, m_stop, m_start < m_stop);
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::counter_type range<T, Step>::resolve_stop(
+    T start, T stop) const {
+  const auto stride = step_base::step();
+  // Checked here, so that the check comes before any division by it.
+  if (!(stride < 0 || stride > 0)) {
+    throw std::out_of_range("Step must be non-zero.");
+  }
+  // Python semantics: the range is empty if stop is not ahead of start.
+  const auto ahead = stride > 0 ? start < stop : start > stop;
+  if (!ahead) return resolve_start(start);
+  if constexpr (is_floating) {
+    // Like numpy.arange, the count is rounded up.
+    const auto span = (stop - start) / stride;
+    if (!(span < static_cast<T>(PTRDIFF_MAX))) {
+      throw std::out_of_range("Range is too long.");
+    }
+    const auto count = static_cast<ptrdiff_t>(span);
+    return static_cast<T>(count) < span ? count + 1 : count;
+  } else {
+    using U = std::uintmax_t;
+    const auto distance = stride > 0
+                              ? static_cast<U>(stop) - static_cast<U>(start)
+                              : static_cast<U>(start) - static_cast<U>(stop);
+    const auto magnitude =
+        stride > 0 ? static_cast<U>(stride) : U(0) - static_cast<U>(stride);
+    const auto count = (distance - 1) / magnitude + 1;
+    return detail::wrapping_advance(static_cast<counter_type>(start),
+                                    static_cast<ptrdiff_t>(count), stride);
+  }
 }
 
-template <typename T>
-inline typename range<T>::iterator range<T>::end() const {
-  return iterator(m_stop, m_stop, m_start < m_stop);
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator range<T, Step>::begin() const {
+  return iterator(m_start, step(), origin_base::origin());
 }
 
-template <typename T>
-inline range<T>::iterator::iterator(T current, T limit, bool direction)
-    : m_current(current), m_limit(limit), is_forward(direction) {}
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator range<T, Step>::end() const {
+  return iterator(m_stop, step(), origin_base::origin());
+}
 
-template <typename T>
-inline typename range<T>::iterator &range<T>::iterator::operator++() {
-  is_forward ? ++m_current : --m_current;
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::step_type range<T, Step>::step() const {
+  return step_base::step();
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr size_t range<T, Step>::size() const {
+  return static_cast<size_t>(end() - begin());
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr T range<T, Step>::operator[](size_t index) const {
+  return begin()[static_cast<ptrdiff_t>(index)];
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr range<T, Step>::iterator::iterator(counter_type current,
+                                             step_type step_in, T origin_in)
+    : step_base(step_in), origin_base(origin_in), m_current(current) {}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr void range<T, Step>::iterator::advance(ptrdiff_t n) {
+  if constexpr (is_floating) {
+    m_current += n;
+  } else {
+    m_current = detail::wrapping_advance(m_current, n, step_base::step());
+  }
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator &
+range<T, Step>::iterator::operator++() {
+  advance(1);
   return *this;
 }
 
-template <typename T>
-inline typename range<T>::iterator range<T>::iterator::operator++(int) {
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator
+range<T, Step>::iterator::operator++(int) {
   auto temp(*this);
   this->operator++();
   return temp;
 }
 
-template <typename T>
-inline typename range<T>::iterator &range<T>::iterator::operator--() {
-  is_forward ? --m_current : ++m_current;
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator &
+range<T, Step>::iterator::operator--() {
+  advance(-1);
   return *this;
 }
 
-template <typename T>
-inline typename range<T>::iterator range<T>::iterator::operator--(int) {
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator
+range<T, Step>::iterator::operator--(int) {
   auto temp(*this);
   this->operator--();
   return temp;
 }
 
-template <typename T>
-inline T range<T>::iterator::operator*() const {
-  return m_current;
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator &
+range<T, Step>::iterator::operator+=(ptrdiff_t n) {
+  advance(n);
+  return *this;
 }
 
-template <typename T>
-inline bool range<T>::iterator::operator==(
-    const typename range<T>::iterator &other) const {
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator &
+range<T, Step>::iterator::operator-=(ptrdiff_t n) {
+  return this->operator+=(-n);
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator range<T, Step>::iterator::
+operator+(ptrdiff_t n) const {
+  auto temp(*this);
+  return temp += n;
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr typename range<T, Step>::iterator range<T, Step>::iterator::
+operator-(ptrdiff_t n) const {
+  auto temp(*this);
+  return temp -= n;
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr ptrdiff_t range<T, Step>::iterator::operator-(
+    const typename range<T, Step>::iterator &other) const {
+  if constexpr (is_floating) {
+    return m_current - other.m_current;
+  } else {
+    return detail::signed_distance(other.m_current, m_current) /
+           static_cast<ptrdiff_t>(step_base::step());
+  }
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr T range<T, Step>::iterator::operator[](ptrdiff_t n) const {
+  return *(*this + n);
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr T range<T, Step>::iterator::operator*() const {
+  if constexpr (is_floating) {
+    return origin_base::origin() +
+           static_cast<T>(m_current) * step_base::step();
+  } else {
+    return static_cast<T>(m_current);
+  }
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr bool range<T, Step>::iterator::operator==(
+    const typename range<T, Step>::iterator &other) const {
   return m_current == other.m_current;
 }
 
-template <typename T>
-inline bool range<T>::iterator::operator!=(
-    const typename range<T>::iterator &other) const {
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr bool range<T, Step>::iterator::operator!=(
+    const typename range<T, Step>::iterator &other) const {
   return m_current != other.m_current;
 }
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr bool range<T, Step>::iterator::operator<(
+    const typename range<T, Step>::iterator &other) const {
+  return *this - other < 0;
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr bool range<T, Step>::iterator::operator>(
+    const typename range<T, Step>::iterator &other) const {
+  return other < *this;
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr bool range<T, Step>::iterator::operator<=(
+    const typename range<T, Step>::iterator &other) const {
+  return !(other < *this);
+}
+
+template <typename T, detail::range_fixed_step_t<T> Step>
+constexpr bool range<T, Step>::iterator::operator>=(
+    const typename range<T, Step>::iterator &other) const {
+  return !(*this < other);
+}
@@ -0,0 +1,845 @@
+/*
+Copyright 2020. Siwei Wang.
+
+Vectorized byte scanning kernels with runtime CPU dispatch.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace detail {
+
+/**
+ * Signature shared by every find_byte kernel.
+ */
+using find_byte_kernel = const char *(*)(const char *, const char *, char);
+
+/**
+ * Signature shared by every count_byte kernel.
+ */
+using count_byte_kernel = size_t (*)(const char *, const char *, char);
+
+/**
+ * Signature shared by every count_words kernel.
+ */
+using count_words_kernel = size_t (*)(const char *, const char *, bool &);
+
+/**
+ * Signature shared by every find_non_ascii kernel.
+ */
+using find_non_ascii_kernel = const char *(*)(const char *, const char *);
+
+/**
+ * Signature shared by every count_utf8 kernel.
+ */
+using count_utf8_kernel = size_t (*)(const char *, const char *);
+
+/**
+ * Signature shared by every find_value kernel for element type T.
+ */
+template <typename T>
+using find_value_kernel = const T *(*)(const T *, const T *, T);
+
+/**
+ * Whether arrays of T can be searched with vector equality compares:
+ * integers compare bitwise, and floating point compares are IEEE
+ * equality, exactly matching operator==.
+ */
+template <typename T>
+constexpr bool is_scannable_v =
+    (std::is_integral_v<T> && !std::is_same_v<T, bool>) ||
+    std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+/**
+ * Whitespace as classified by std::isspace in the "C" locale.
+ */
+inline bool is_space(char c) {
+  return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+/**
+ * Portable fallback kernels. memchr is usually vectorized by libc.
+ */
+inline const char *find_byte_scalar(const char *first, const char *last,
+                                    char c) {
+  // Empty containers may have a null data pointer, which memchr rejects.
+  if (first == last) return last;
+  const auto spot = std::memchr(first, c, static_cast<size_t>(last - first));
+  return spot ? static_cast<const char *>(spot) : last;
+}
+
+inline size_t count_byte_scalar(const char *first, const char *last, char c) {
+  size_t counter = 0;
+  for (; first != last; ++first) counter += (*first == c);
+  return counter;
+}
+
+template <typename T>
+inline const T *find_value_scalar(const T *first, const T *last, T value) {
+  return std::find(first, last, value);
+}
+
+inline size_t count_words_scalar(const char *first, const char *last,
+                                 bool &after_space) {
+  size_t counter = 0;
+  for (; first != last; ++first) {
+    const auto space = is_space(*first);
+    counter += after_space && !space;
+    after_space = space;
+  }
+  return counter;
+}
+
+/**
+ * Decodes the UTF-8 sequence at first into code and returns its length.
+ * A byte that does not begin a well-formed sequence decodes on its own
+ * to U+FFFD, so every byte of malformed input counts as one character.
+ * REQUIRES: first != last.
+ */
+inline size_t utf8_decode(const char *first, const char *last,
+                          char32_t &code) {
+  const auto byte = [first](size_t i) {
+    return static_cast<unsigned char>(first[i]);
+  };
+  const auto lead = byte(0);
+  code = lead;
+  if (lead < 0x80) return 1;
+  // Well-formed sequences from table 3-7 of the Unicode standard.
+  size_t length = 0;
+  unsigned char low = 0x80, high = 0xBF;
+  if (0xC2 <= lead && lead <= 0xDF) {
+    length = 2;
+  } else if (0xE0 <= lead && lead <= 0xEF) {
+    length = 3;
+    if (lead == 0xE0) low = 0xA0;
+    if (lead == 0xED) high = 0x9F;
+  } else if (0xF0 <= lead && lead <= 0xF4) {
+    length = 4;
+    if (lead == 0xF0) low = 0x90;
+    if (lead == 0xF4) high = 0x8F;
+  }
+  code = 0xFFFD;
+  if (length == 0 || static_cast<size_t>(last - first) < length ||
+      byte(1) < low || byte(1) > high) {
+    return 1;
+  }
+  char32_t value = lead & (0x7Fu >> length);
+  for (size_t i = 1; i < length; ++i) {
+    if ((byte(i) & 0xC0) != 0x80) return 1;
+    value = (value << 6) | (byte(i) & 0x3Fu);
+  }
+  code = value;
+  return length;
+}
+
+/**
+ * Whether code has the Unicode White_Space property.
+ */
+inline bool is_unicode_space(char32_t code) {
+  if (code < 0x80) return is_space(static_cast<char>(code));
+  return code == 0x85 || code == 0xA0 || code == 0x1680 ||
+         (0x2000 <= code && code <= 0x200A) || code == 0x2028 ||
+         code == 0x2029 || code == 0x202F || code == 0x205F || code == 0x3000;
+}
+
+inline const char *find_non_ascii_scalar(const char *first, const char *last) {
+  while (first != last && static_cast<unsigned char>(*first) < 0x80) ++first;
+  return first;
+}
+
+inline size_t count_utf8_scalar(const char *first, const char *last) {
+  size_t counter = 0;
+  for (char32_t code; first != last; ++counter) {
+    first += utf8_decode(first, last, code);
+  }
+  return counter;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+/**
+ * SSE2 kernels. SSE2 is part of the x86-64 baseline.
+ */
+inline const char *find_byte_sse2(const char *first, const char *last,
+                                  char c) {
+  const auto needle = _mm_set1_epi8(c);
+  for (; last - first >= 16; first += 16) {
+    const auto block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+    const auto mask = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+    if (mask) return first + __builtin_ctz(mask);
+  }
+  return find_byte_scalar(first, last, c);
+}
+
+inline size_t count_byte_sse2(const char *first, const char *last, char c) {
+  const auto needle = _mm_set1_epi8(c);
+  const auto zero = _mm_setzero_si128();
+  size_t counter = 0;
+  while (last - first >= 16) {
+    // Byte lanes overflow after 255 matches, so flush them periodically.
+    auto rounds = static_cast<size_t>(last - first) / 16;
+    if (rounds > 255) rounds = 255;
+    auto lanes = zero;
+    for (; rounds; --rounds, first += 16) {
+      const auto block =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+      lanes = _mm_sub_epi8(lanes, _mm_cmpeq_epi8(block, needle));
+    }
+    const auto sums = _mm_sad_epu8(lanes, zero);
+    counter += static_cast<size_t>(_mm_cvtsi128_si64(sums)) +
+               static_cast<size_t>(_mm_extract_epi16(sums, 4));
+  }
+  return counter + count_byte_scalar(first, last, c);
+}
+
+/**
+ * Bit mask of the whitespace bytes in a 16 byte block.
+ */
+inline unsigned space_mask_sse2(__m128i block) {
+  // Tab through carriage return are contiguous: block - '\t' <= 4.
+  const auto shifted = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+  const auto control = _mm_cmpeq_epi8(
+      _mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+  const auto blank = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+  return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(control, blank)));
+}
+
+inline size_t count_words_sse2(const char *first, const char *last,
+                               bool &after_space) {
+  size_t counter = 0;
+  for (; last - first >= 16; first += 16) {
+    const auto spaces = space_mask_sse2(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(first)));
+    // A word starts at every non-space byte that follows a space.
+    const auto follows = (spaces << 1) | static_cast<unsigned>(after_space);
+    counter += static_cast<size_t>(
+        __builtin_popcount(follows & ~spaces & 0xFFFFu));
+    after_space = (spaces >> 15) & 1u;
+  }
+  return counter + count_words_scalar(first, last, after_space);
+}
+
+inline const char *find_non_ascii_sse2(const char *first, const char *last) {
+  for (; last - first >= 16; first += 16) {
+    const auto mask = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(first))));
+    if (mask) return first + __builtin_ctz(mask);
+  }
+  return find_non_ascii_scalar(first, last);
+}
+
+/**
+ * Bit mask of the bytes in the 16 byte block at spot
+ * that belong to elements equal to value.
+ */
+template <typename T>
+inline unsigned equal_mask_sse2(const T *spot, T value) {
+  __m128i equal;
+  if constexpr (std::is_same_v<T, float>) {
+    equal = _mm_castps_si128(
+        _mm_cmpeq_ps(_mm_loadu_ps(spot), _mm_set1_ps(value)));
+  } else if constexpr (std::is_same_v<T, double>) {
+    equal = _mm_castpd_si128(
+        _mm_cmpeq_pd(_mm_loadu_pd(spot), _mm_set1_pd(value)));
+  } else {
+    const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(spot));
+    if constexpr (sizeof(T) == 2) {
+      equal = _mm_cmpeq_epi16(block, _mm_set1_epi16(static_cast<short>(value)));
+    } else if constexpr (sizeof(T) == 4) {
+      equal = _mm_cmpeq_epi32(block, _mm_set1_epi32(static_cast<int>(value)));
+    } else {
+      // SSE2 has no 64 bit compare: both 32 bit halves must match.
+      const auto halves = _mm_cmpeq_epi32(
+          block, _mm_set1_epi64x(static_cast<long long>(value)));
+      equal = _mm_and_si128(halves,
+                            _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+  }
+  return static_cast<unsigned>(_mm_movemask_epi8(equal));
+}
+
+template <typename T>
+inline const T *find_value_sse2(const T *first, const T *last, T value) {
+  constexpr ptrdiff_t lanes = 16 / sizeof(T);
+  for (; last - first >= lanes; first += lanes) {
+    const auto mask = equal_mask_sse2(first, value);
+    if (mask) return first + __builtin_ctz(mask) / sizeof(T);
+  }
+  return find_value_scalar(first, last, value);
+}
+
+/**
+ * AVX2 kernels. Only called once the CPU is known to support AVX2.
+ */
+__attribute__((target("avx2"))) inline const char *find_byte_avx2(
+    const char *first, const char *last, char c) {
+  const auto needle = _mm256_set1_epi8(c);
+  for (; last - first >= 32; first += 32) {
+    const auto block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+    const auto mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+    if (mask) return first + __builtin_ctz(mask);
+  }
+  return find_byte_sse2(first, last, c);
+}
+
+__attribute__((target("avx2"))) inline size_t count_byte_avx2(
+    const char *first, const char *last, char c) {
+  const auto needle = _mm256_set1_epi8(c);
+  const auto zero = _mm256_setzero_si256();
+  size_t counter = 0;
+  while (last - first >= 32) {
+    // Byte lanes overflow after 255 matches, so flush them periodically.
+    auto rounds = static_cast<size_t>(last - first) / 32;
+    if (rounds > 255) rounds = 255;
+    auto lanes = zero;
+    for (; rounds; --rounds, first += 32) {
+      const auto block =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+      lanes = _mm256_sub_epi8(lanes, _mm256_cmpeq_epi8(block, needle));
+    }
+    const auto sums = _mm256_sad_epu8(lanes, zero);
+    counter += static_cast<size_t>(_mm256_extract_epi64(sums, 0)) +
+               static_cast<size_t>(_mm256_extract_epi64(sums, 1)) +
+               static_cast<size_t>(_mm256_extract_epi64(sums, 2)) +
+               static_cast<size_t>(_mm256_extract_epi64(sums, 3));
+  }
+  return counter + count_byte_sse2(first, last, c);
+}
+
+__attribute__((target("avx2"))) inline size_t count_words_avx2(
+    const char *first, const char *last, bool &after_space) {
+  const auto tab = _mm256_set1_epi8('\t');
+  const auto span = _mm256_set1_epi8('\r' - '\t');
+  const auto blank = _mm256_set1_epi8(' ');
+  size_t counter = 0;
+  for (; last - first >= 32; first += 32) {
+    const auto block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+    const auto shifted = _mm256_sub_epi8(block, tab);
+    const auto control =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, span), shifted);
+    const auto spaces = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_or_si256(control, _mm256_cmpeq_epi8(block, blank))));
+    // A word starts at every non-space byte that follows a space.
+    const auto follows = (spaces << 1) | static_cast<uint32_t>(after_space);
+    counter += static_cast<size_t>(__builtin_popcount(follows & ~spaces));
+    after_space = (spaces >> 31) & 1u;
+  }
+  return counter + count_words_sse2(first, last, after_space);
+}
+
+__attribute__((target("avx2"))) inline const char *find_non_ascii_avx2(
+    const char *first, const char *last) {
+  for (; last - first >= 32; first += 32) {
+    const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first))));
+    if (mask) return first + __builtin_ctz(mask);
+  }
+  return find_non_ascii_sse2(first, last);
+}
+
+/**
+ * The 32 bytes that end N bytes into block, where prev is the block
+ * before it, so that every byte lines up with the one N before it.
+ */
+template <int N>
+__attribute__((target("avx2"))) inline __m256i shift_in_avx2(__m256i block,
+                                                             __m256i prev) {
+  return _mm256_alignr_epi8(
+      block, _mm256_permute2x128_si256(prev, block, 0x21), 16 - N);
+}
+
+/**
+ * A 16 entry byte table repeated in both lanes, for _mm256_shuffle_epi8.
+ */
+__attribute__((target("avx2"))) inline __m256i table_avx2(
+    const unsigned char (&entries)[16]) {
+  return _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(entries)));
+}
+
+/**
+ * Nonzero bytes wherever block, read after prev, breaks UTF-8 rules.
+ * Each byte is classified from its high nibble, and from both nibbles of
+ * the byte before it, and the three lookups agree only on an error.
+ * This is the lookup method of Keiser and Lemire, "Validating UTF-8 In
+ * Less Than One Instruction Per Byte". A sequence left open at the end
+ * of block is not an error until the next block fails to continue it.
+ */
+__attribute__((target("avx2"))) inline __m256i utf8_errors_avx2(
+    __m256i block, __m256i prev) {
+  // Error classes, one bit each. Several share a bit where the
+  // byte pairs they describe cannot overlap.
+  constexpr unsigned char too_short = 1 << 0;
+  constexpr unsigned char too_long = 1 << 1;
+  constexpr unsigned char overlong_3 = 1 << 2;
+  constexpr unsigned char too_large = 1 << 3;
+  constexpr unsigned char surrogate = 1 << 4;
+  constexpr unsigned char overlong_2 = 1 << 5;
+  constexpr unsigned char too_large_1000 = 1 << 6;
+  constexpr unsigned char overlong_4 = 1 << 6;
+  constexpr unsigned char two_conts = 1 << 7;
+  constexpr unsigned char carry = too_short | too_long | two_conts;
+
+  static const unsigned char first_high[16] = {
+      too_long,  too_long,  too_long,  too_long,
+      too_long,  too_long,  too_long,  too_long,
+      two_conts, two_conts, two_conts, two_conts,
+      too_short | overlong_2,
+      too_short,
+      too_short | overlong_3 | surrogate,
+      too_short | too_large | too_large_1000 | overlong_4};
+  static const unsigned char first_low[16] = {
+      carry | overlong_3 | overlong_2 | overlong_4,
+      carry | overlong_2,
+      carry,
+      carry,
+      carry | too_large,
+      carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000 | surrogate,
+      carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000};
+  static const unsigned char second_high[16] = {
+      too_short, too_short, too_short, too_short,
+      too_short, too_short, too_short, too_short,
+      too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 |
+          overlong_4,
+      too_long | overlong_2 | two_conts | overlong_3 | too_large,
+      too_long | overlong_2 | two_conts | surrogate | too_large,
+      too_long | overlong_2 | two_conts | surrogate | too_large,
+      too_short, too_short, too_short, too_short};
+
+  const auto nibble = _mm256_set1_epi8(0x0F);
+  const auto prev1 = shift_in_avx2<1>(block, prev);
+  const auto special = _mm256_and_si256(
+      _mm256_and_si256(
+          _mm256_shuffle_epi8(
+              table_avx2(first_high),
+              _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+          _mm256_shuffle_epi8(table_avx2(first_low),
+                              _mm256_and_si256(prev1, nibble))),
+      _mm256_shuffle_epi8(
+          table_avx2(second_high),
+          _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble)));
+  // The third and fourth bytes of a sequence must be continuations too.
+  const auto third = _mm256_subs_epu8(shift_in_avx2<2>(block, prev),
+                                      _mm256_set1_epi8(0xE0 - 0x80));
+  const auto fourth = _mm256_subs_epu8(
+      shift_in_avx2<3>(block, prev),
+      _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+  const auto continued = _mm256_and_si256(
+      _mm256_or_si256(third, fourth),
+      _mm256_set1_epi8(static_cast<char>(0x80)));
+  return _mm256_xor_si256(continued, special);
+}
+
+/**
+ * Whether block ends partway into a multibyte sequence.
+ */
+__attribute__((target("avx2"))) inline bool utf8_open_avx2(__m256i block) {
+  // Bytes greater than these begin a sequence too long to fit before
+  // the end of the block.
+  const auto limits = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1),
+      static_cast<char>(0xC0 - 1));
+  const auto over = _mm256_subs_epu8(block, limits);
+  return !_mm256_testz_si256(over, over);
+}
+
+/**
+ * Steps back from first to the start of the sequence the vector loop
+ * left open before it, uncounting that sequence so it can be decoded.
+ */
+inline const char *utf8_reopen(const char *first, size_t &counter) {
+  for (ptrdiff_t back = 1; back <= 3; ++back) {
+    const auto byte = static_cast<unsigned char>(first[-back]);
+    if ((byte & 0xC0) == 0x80) continue;
+    const ptrdiff_t length = byte >= 0xF0   ? 4
+                             : byte >= 0xE0 ? 3
+                             : byte >= 0xC0 ? 2
+                                            : 1;
+    if (length <= back) break;
+    --counter;
+    return first - back;
+  }
+  return first;
+}
+
+/**
+ * Counts code points a block at a time. Blocks of ASCII and blocks of
+ * well-formed UTF-8 are counted by their non-continuation bytes. Blocks
+ * with errors are decoded one sequence at a time instead, so malformed
+ * input counts exactly as count_utf8_scalar counts it.
+ */
+__attribute__((target("avx2"))) inline size_t count_utf8_avx2(
+    const char *first, const char *last) {
+  const auto continuation = _mm256_set1_epi8(static_cast<char>(0xBF));
+  size_t counter = 0;
+  // The block before first, or zeros after decoding one by one.
+  auto prev = _mm256_setzero_si256();
+  bool open = false;
+  while (last - first >= 32) {
+    const auto block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+    if (!open && _mm256_movemask_epi8(block) == 0) {
+      counter += 32;
+    } else {
+      const auto errors = utf8_errors_avx2(block, prev);
+      if (!_mm256_testz_si256(errors, errors)) {
+        const auto stop = first + 32;
+        if (open) first = utf8_reopen(first, counter);
+        for (char32_t code; first < stop; ++counter) {
+          first += utf8_decode(first, last, code);
+        }
+        prev = _mm256_setzero_si256();
+        open = false;
+        continue;
+      }
+      // Signed bytes above 0xBF are ASCII or lead bytes.
+      counter += static_cast<size_t>(__builtin_popcount(
+          static_cast<unsigned>(_mm256_movemask_epi8(
+              _mm256_cmpgt_epi8(block, continuation)))));
+      open = utf8_open_avx2(block);
+    }
+    prev = block;
+    first += 32;
+  }
+  if (open) first = utf8_reopen(first, counter);
+  return counter + count_utf8_scalar(first, last);
+}
+
+/**
+ * Bit mask of the bytes in the 32 byte block at spot
+ * that belong to elements equal to value.
+ */
+template <typename T>
+__attribute__((target("avx2"))) inline unsigned equal_mask_avx2(const T *spot,
+                                                                 T value) {
+  __m256i equal;
+  if constexpr (std::is_same_v<T, float>) {
+    equal = _mm256_castps_si256(_mm256_cmp_ps(
+        _mm256_loadu_ps(spot), _mm256_set1_ps(value), _CMP_EQ_OQ));
+  } else if constexpr (std::is_same_v<T, double>) {
+    equal = _mm256_castpd_si256(_mm256_cmp_pd(
+        _mm256_loadu_pd(spot), _mm256_set1_pd(value), _CMP_EQ_OQ));
+  } else {
+    const auto block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(spot));
+    if constexpr (sizeof(T) == 2) {
+      equal = _mm256_cmpeq_epi16(block,
+                                 _mm256_set1_epi16(static_cast<short>(value)));
+    } else if constexpr (sizeof(T) == 4) {
+      equal =
+          _mm256_cmpeq_epi32(block, _mm256_set1_epi32(static_cast<int>(value)));
+    } else {
+      equal = _mm256_cmpeq_epi64(
+          block, _mm256_set1_epi64x(static_cast<long long>(value)));
+    }
+  }
+  return static_cast<unsigned>(_mm256_movemask_epi8(equal));
+}
+
+template <typename T>
+__attribute__((target("avx2"))) inline const T *find_value_avx2(
+    const T *first, const T *last, T value) {
+  constexpr ptrdiff_t lanes = 32 / sizeof(T);
+  for (; last - first >= lanes; first += lanes) {
+    const auto mask = equal_mask_avx2(first, value);
+    if (mask) return first + __builtin_ctz(mask) / sizeof(T);
+  }
+  return find_value_sse2(first, last, value);
+}
+
+/**
+ * AVX-512 kernels. Only called once the CPU is known to support the
+ * foundation and byte/word instructions. Compares yield one bit per
+ * element, so no movemask step is needed.
+ */
+template <typename T>
+__attribute__((target("avx512f,avx512bw"))) inline const T *find_value_avx512(
+    const T *first, const T *last, T value) {
+  constexpr ptrdiff_t lanes = 64 / sizeof(T);
+  for (; last - first >= lanes; first += lanes) {
+    uint64_t mask;
+    if constexpr (std::is_same_v<T, float>) {
+      mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(first), _mm512_set1_ps(value),
+                                _CMP_EQ_OQ);
+    } else if constexpr (std::is_same_v<T, double>) {
+      mask = _mm512_cmp_pd_mask(_mm512_loadu_pd(first), _mm512_set1_pd(value),
+                                _CMP_EQ_OQ);
+    } else {
+      const auto block = _mm512_loadu_si512(first);
+      if constexpr (sizeof(T) == 2) {
+        mask = _mm512_cmpeq_epi16_mask(
+            block, _mm512_set1_epi16(static_cast<short>(value)));
+      } else if constexpr (sizeof(T) == 4) {
+        mask = _mm512_cmpeq_epi32_mask(
+            block, _mm512_set1_epi32(static_cast<int>(value)));
+      } else {
+        mask = _mm512_cmpeq_epi64_mask(
+            block, _mm512_set1_epi64(static_cast<long long>(value)));
+      }
+    }
+    if (mask) return first + __builtin_ctzll(mask);
+  }
+  return find_value_avx2(first, last, value);
+}
+
+/**
+ * Whether AVX-512 kernels may be used on this CPU.
+ */
+inline bool has_avx512() {
+  static const bool supported =
+      __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+  return supported;
+}
+
+/**
+ * Whether AVX2 kernels may be used on this CPU.
+ */
+inline bool has_avx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+
+inline find_byte_kernel select_find_byte() {
+  return has_avx2() ? find_byte_avx2 : find_byte_sse2;
+}
+
+inline count_byte_kernel select_count_byte() {
+  return has_avx2() ? count_byte_avx2 : count_byte_sse2;
+}
+
+inline count_words_kernel select_count_words() {
+  return has_avx2() ? count_words_avx2 : count_words_sse2;
+}
+
+inline find_non_ascii_kernel select_find_non_ascii() {
+  return has_avx2() ? find_non_ascii_avx2 : find_non_ascii_sse2;
+}
+
+inline count_utf8_kernel select_count_utf8() {
+  return has_avx2() ? count_utf8_avx2 : count_utf8_scalar;
+}
+
+template <typename T>
+inline find_value_kernel<T> select_find_value() {
+  if (has_avx512()) return find_value_avx512<T>;
+  return has_avx2() ? find_value_avx2<T> : find_value_sse2<T>;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+/**
+ * NEON kernels. NEON is part of the AArch64 baseline.
+ */
+inline const char *find_byte_neon(const char *first, const char *last,
+                                  char c) {
+  const auto needle = vdupq_n_u8(static_cast<uint8_t>(c));
+  for (; last - first >= 16; first += 16) {
+    const auto block = vld1q_u8(reinterpret_cast<const uint8_t *>(first));
+    if (vmaxvq_u8(vceqq_u8(block, needle))) break;
+  }
+  return find_byte_scalar(first, last, c);
+}
+
+inline size_t count_byte_neon(const char *first, const char *last, char c) {
+  const auto needle = vdupq_n_u8(static_cast<uint8_t>(c));
+  size_t counter = 0;
+  while (last - first >= 16) {
+    // Byte lanes overflow after 255 matches, so flush them periodically.
+    auto rounds = static_cast<size_t>(last - first) / 16;
+    if (rounds > 255) rounds = 255;
+    auto lanes = vdupq_n_u8(0);
+    for (; rounds; --rounds, first += 16) {
+      const auto block = vld1q_u8(reinterpret_cast<const uint8_t *>(first));
+      lanes = vsubq_u8(lanes, vceqq_u8(block, needle));
+    }
+    counter += vaddlvq_u8(lanes);
+  }
+  return counter + count_byte_scalar(first, last, c);
+}
+
+inline find_byte_kernel select_find_byte() { return find_byte_neon; }
+
+inline count_byte_kernel select_count_byte() { return count_byte_neon; }
+
+inline count_words_kernel select_count_words() { return count_words_scalar; }
+
+inline find_non_ascii_kernel select_find_non_ascii() {
+  return find_non_ascii_scalar;
+}
+
+inline count_utf8_kernel select_count_utf8() { return count_utf8_scalar; }
+
+template <typename T>
+inline find_value_kernel<T> select_find_value() {
+  return find_value_scalar<T>;
+}
+
+#else
+
+inline find_byte_kernel select_find_byte() { return find_byte_scalar; }
+
+inline count_byte_kernel select_count_byte() { return count_byte_scalar; }
+
+inline count_words_kernel select_count_words() { return count_words_scalar; }
+
+inline find_non_ascii_kernel select_find_non_ascii() {
+  return find_non_ascii_scalar;
+}
+
+inline count_utf8_kernel select_count_utf8() { return count_utf8_scalar; }
+
+template <typename T>
+inline find_value_kernel<T> select_find_value() {
+  return find_value_scalar<T>;
+}
+
+#endif
+
+/**
+ * Returns a pointer to the first c in [first, last), or last if none.
+ * The widest kernel supported by the CPU is selected on first use.
+ */
+inline const char *find_byte(const char *first, const char *last, char c) {
+  static const auto kernel = select_find_byte();
+  return kernel(first, last, c);
+}
+
+/**
+ * Returns the number of times c occurs in [first, last).
+ * The widest kernel supported by the CPU is selected on first use.
+ */
+inline size_t count_byte(const char *first, const char *last, char c) {
+  static const auto kernel = select_count_byte();
+  return kernel(first, last, c);
+}
+
+/**
+ * Returns the number of words that start in [first, last). A word is
+ * a maximal run of non-space bytes. after_space tells whether the byte
+ * before first was a space, and is updated to describe the last byte.
+ */
+inline size_t count_words(const char *first, const char *last,
+                          bool &after_space) {
+  static const auto kernel = select_count_words();
+  return kernel(first, last, after_space);
+}
+
+/**
+ * Returns a pointer to the first byte in [first, last) that is not
+ * ASCII, or last if none.
+ * The widest kernel supported by the CPU is selected on first use.
+ */
+inline const char *find_non_ascii(const char *first, const char *last) {
+  static const auto kernel = select_find_non_ascii();
+  return kernel(first, last);
+}
+
+/**
+ * Returns the number of UTF-8 code points in [first, last). Each byte
+ * that is not part of a well-formed sequence counts as one.
+ * The widest kernel supported by the CPU is selected on first use.
+ */
+inline size_t count_utf8(const char *first, const char *last) {
+  static const auto kernel = select_count_utf8();
+  return kernel(first, last);
+}
+
+/**
+ * Returns the number of words that start in [first, last), where words
+ * are separated by Unicode whitespace. Runs of ASCII are handed to
+ * count_words, and only the other code points are decoded. after_space
+ * is as in count_words.
+ */
+inline size_t count_utf8_words(const char *first, const char *last,
+                               bool &after_space) {
+  // Runs are looked for a page at a time, so count_words reads each
+  // run while it is still in cache.
+  constexpr ptrdiff_t window = 4096;
+  size_t counter = 0;
+  while (first != last) {
+    const auto stop = last - first > window ? first + window : last;
+    const auto spot = find_non_ascii(first, stop);
+    if (spot != first) counter += count_words(first, spot, after_space);
+    if (spot == stop) {
+      first = stop;
+      continue;
+    }
+    char32_t code;
+    first = spot + utf8_decode(spot, last, code);
+    const auto space = is_unicode_space(code);
+    counter += after_space && !space;
+    after_space = space;
+  }
+  return counter;
+}
+
+/**
+ * Returns how many bytes at the end of [first, last) begin a UTF-8
+ * sequence that last cuts short. Counting text a block at a time, they
+ * are held back for the next block so that no sequence is split.
+ */
+inline size_t utf8_partial(const char *first, const char *last) {
+  const auto size = static_cast<size_t>(last - first);
+  for (size_t back = 1; back <= 3 && back <= size; ++back) {
+    const auto lead = static_cast<unsigned char>(*(last - back));
+    if ((lead & 0xC0) == 0x80) continue;
+    size_t length = 1;
+    if (lead >= 0xF0) {
+      length = 4;
+    } else if (lead >= 0xE0) {
+      length = 3;
+    } else if (lead >= 0xC0) {
+      length = 2;
+    }
+    return length > back ? back : 0;
+  }
+  return 0;
+}
+
+/**
+ * REQUIRES: is_scannable_v<T>.
+ * Returns a pointer to the first value in [first, last), or last if
+ * none. Single bytes are searched with find_byte. Otherwise, the
+ * widest kernel supported by the CPU is selected on first use.
+ */
+template <typename T>
+inline const T *find_value(const T *first, const T *last, T value) {
+  static_assert(is_scannable_v<T>, "Elements must be integers or floats.");
+  if constexpr (sizeof(T) == 1) {
+    const auto begin = reinterpret_cast<const char *>(first);
+    const auto spot = find_byte(begin, reinterpret_cast<const char *>(last),
+                                static_cast<char>(value));
+    return first + (spot - begin);
+  } else {
+    static const auto kernel = select_find_value<T>();
+    return kernel(first, last, value);
+  }
+}
+
+}  // namespace detail
@@ -5,118 +5,956 @@ Operations over sequences.
 */
 #pragma once
 
+#include <algorithm>
 #include <iterator>
+#include <memory_resource>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
+#include "instrument.h"
+#include "scan.h"
+#include "small_vector.h"
+
+namespace detail {
+
+/**
+ * Split items into a list of the given type, holding containers
+ * delimited by delim. Any list with emplace_back will do.
+ * THROWS: std::out_of_range if a string delimiter is empty.
+ */
+template <typename Tokens, typename Container, typename T>
+Tokens split_as(const Container &items, const T &delim) {
+  instrument_probe probe(instrumented::split);
+  probe.add_bytes(std::size(items) * sizeof(*std::begin(items)));
+  Tokens tokens;
+  if constexpr (std::is_same_v<Container, std::string> &&
+                std::is_same_v<T, std::string>) {
+    if (delim.empty()) throw std::out_of_range("Delimiter cannot be empty.");
+    if (delim.size() > 1) {
+      // Searches resume past each delimiter, so matches never overlap.
+      for (size_t first = 0; first < items.size();) {
+        auto last = items.find(delim, first);
+        if (last == std::string::npos) last = items.size();
+        if (last != first) tokens.emplace_back(items, first, last - first);
+        first = last + delim.size();
+      }
+      return tokens;
+    }
+  }
+  if constexpr (std::is_same_v<Container, std::string> &&
+                (std::is_same_v<T, char> || std::is_same_v<T, std::string>)) {
+    // Contiguous characters can be scanned many bytes at a time.
+    char target;
+    if constexpr (std::is_same_v<T, char>) {
+      target = delim;
+    } else {
+      target = delim.front();
+    }
+    const auto stop = items.data() + items.size();
+    for (auto first = items.data(); first != stop;) {
+      auto spot = detail::find_byte(first, stop, target);
+      if (first != spot) tokens.emplace_back(first, spot);
+      first = (spot == stop) ? stop : std::next(spot);
+    }
+  } else {
+    for (auto iter = items.begin(); iter != items.end();) {
+      auto spot = std::find(iter, items.end(), delim);
+      if (iter != spot) tokens.emplace_back(iter, spot);
+      iter = (spot == items.end()) ? items.end() : std::next(spot);
+    }
+  }
+  return tokens;
+}
+
+}  // namespace detail
+
 /**
  * Split container into a list of containers delimited
  * by the given delimiter parameter.
+ * THROWS: std::out_of_range if a string delimiter is empty.
  */
 template <typename Container, typename T>
 std::vector<Container> split(const Container &items, const T &delim) {
-  std::vector<Container> tokens;
-  for (auto iter = items.begin(); iter != items.end();) {
-    auto spot = find(iter, items.end(), delim);
-    if (iter != spot) tokens.emplace_back(iter, spot);
-    iter = (spot == items.end()) ? items.end() : std::next(spot);
+  return detail::split_as<std::vector<Container>>(items, delim);
+}
+
+/**
+ * Split as above, into a small_vector that keeps the first N tokens
+ * inline. Splits into at most N tokens make just the token strings'
+ * own allocations, and none for the list: split<16>(line, ',').
+ * THROWS: std::out_of_range if a string delimiter is empty.
+ */
+template <size_t N, typename Container, typename T>
+small_vector<Container, N> split(const Container &items, const T &delim) {
+  return detail::split_as<small_vector<Container, N>>(items, delim);
+}
+
+/**
+ * Lazy split of a string into views delimited by the given delimiter.
+ * Tokens are found one at a time as the range is traversed.
+ * REQUIRES: Delim is char or std::string_view.
+ * REQUIRES: items and delim outlive the range and its tokens.
+ * THROWS: std::out_of_range if a string delimiter is empty.
+ */
+template <typename Delim>
+class split_range {
+ private:
+  const std::string_view m_items;
+  const Delim m_delim;
+
+  /**
+   * Number of characters spanned by the delimiter.
+   */
+  size_t delim_size() const;
+
+  /**
+   * Position of the next delimiter at or after pos, or size if none.
+   */
+  size_t find_delim(size_t pos) const;
+
+ public:
+  split_range() = delete;
+
+  /**
+   * Split range should be passed the string and delimiter to split on.
+   */
+  split_range(std::string_view, Delim);
+
+  // Declare forward iterators.
+  class iterator {
+    friend class split_range;
+
+   private:
+    const split_range *m_parent;
+
+    /**
+     * Current token is [m_first, m_last). At the end, both are size.
+     */
+    size_t m_first;
+    size_t m_last;
+
+    /**
+     * Constructor that finds the first token at or after pos.
+     */
+    iterator(const split_range *, size_t);
+
+    /**
+     * Moves to the first non-empty token at or after pos.
+     */
+    void seek(size_t);
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = ptrdiff_t;
+    using pointer = const std::string_view *;
+    using reference = std::string_view;
+
+    iterator() = delete;
+
+    // Increment operator.
+
+    iterator &operator++();
+    iterator operator++(int);
+
+    // Dereference operator.
+
+    std::string_view operator*() const;
+
+    // These iterators do not support arrow operators.
+
+    // Comparison operators.
+
+    bool operator==(const iterator &) const;
+    bool operator!=(const iterator &) const;
+  };
+
+  /**
+   * An iterator to the first token.
+   */
+  iterator begin() const;
+
+  /**
+   * An iterator to one past the last token.
+   */
+  iterator end() const;
+};
+
+split_range(std::string_view, const char *) -> split_range<std::string_view>;
+split_range(std::string_view, const std::string &)
+    -> split_range<std::string_view>;
+
+template <typename Delim>
+inline split_range<Delim>::split_range(std::string_view items, Delim delim)
+    : m_items(items), m_delim(delim) {
+  static_assert(std::is_same_v<Delim, char> ||
+                std::is_same_v<Delim, std::string_view>);
+  if (delim_size() == 0) throw std::out_of_range("Delimiter cannot be empty.");
+}
+
+template <typename Delim>
+inline size_t split_range<Delim>::delim_size() const {
+  if constexpr (std::is_same_v<Delim, char>) {
+    return 1;
+  } else {
+    return m_delim.size();
+  }
+}
+
+template <typename Delim>
+inline size_t split_range<Delim>::find_delim(size_t pos) const {
+  if constexpr (std::is_same_v<Delim, char>) {
+    const auto first = m_items.data();
+    const auto last = first + m_items.size();
+    return static_cast<size_t>(
+        detail::find_byte(std::next(first, static_cast<ptrdiff_t>(pos)), last,
+                          m_delim) -
+        first);
+  } else {
+    const auto spot = m_items.find(m_delim, pos);
+    return spot == std::string_view::npos ? m_items.size() : spot;
+  }
+}
+
+template <typename Delim>
+inline typename split_range<Delim>::iterator split_range<Delim>::begin()
+    const {
+  return iterator(this, 0);
+}
+
+template <typename Delim>
+inline typename split_range<Delim>::iterator split_range<Delim>::end() const {
+  return iterator(this, m_items.size());
+}
+
+template <typename Delim>
+inline split_range<Delim>::iterator::iterator(const split_range *parent,
+                                              size_t pos)
+    : m_parent(parent), m_first(pos), m_last(pos) {
+  seek(pos);
+}
+
+template <typename Delim>
+inline void split_range<Delim>::iterator::seek(size_t pos) {
+  const auto size = m_parent->m_items.size();
+  // Skip over empty tokens between adjacent delimiters.
+  for (; pos < size; pos += m_parent->delim_size()) {
+    const auto spot = m_parent->find_delim(pos);
+    if (spot != pos) {
+      m_first = pos;
+      m_last = spot;
+      return;
+    }
+  }
+  m_first = m_last = size;
+}
+
+template <typename Delim>
+inline typename split_range<Delim>::iterator &
+split_range<Delim>::iterator::operator++() {
+  seek(m_last == m_parent->m_items.size() ? m_last
+                                          : m_last + m_parent->delim_size());
+  return *this;
+}
+
+template <typename Delim>
+inline typename split_range<Delim>::iterator
+split_range<Delim>::iterator::operator++(int) {
+  auto temp(*this);
+  this->operator++();
+  return temp;
+}
+
+template <typename Delim>
+inline std::string_view split_range<Delim>::iterator::operator*() const {
+  return m_parent->m_items.substr(m_first, m_last - m_first);
+}
+
+template <typename Delim>
+inline bool split_range<Delim>::iterator::operator==(
+    const typename split_range<Delim>::iterator &other) const {
+  return m_first == other.m_first;
+}
+
+template <typename Delim>
+inline bool split_range<Delim>::iterator::operator!=(
+    const typename split_range<Delim>::iterator &other) const {
+  return m_first != other.m_first;
+}
+
+/**
+ * Split a string into views like split_view, but refill out in place.
+ * out is cleared first and keeps its capacity, so splitting many lines
+ * with similar field counts into one list stops allocating at all.
+ * THROWS: std::out_of_range if a string delimiter is empty.
+ */
+template <typename Delim, typename Alloc>
+void split_into(std::string_view items, const Delim &delim,
+                std::vector<std::string_view, Alloc> &out) {
+  out.clear();
+  for (auto token : split_range(items, delim)) out.push_back(token);
+}
+
+/**
+ * Split UTF-8 text into views of the words between runs of Unicode
+ * whitespace, much as Python's str.split() does with no arguments.
+ * Malformed bytes are kept inside words.
+ */
+inline std::vector<std::string_view> split_words(std::string_view text) {
+  std::vector<std::string_view> words;
+  const auto first = text.data();
+  const auto last = first + text.size();
+  const char *start = nullptr;
+  for (auto spot = first; spot != last;) {
+    char32_t code;
+    const auto length = detail::utf8_decode(spot, last, code);
+    if (detail::is_unicode_space(code)) {
+      if (start) words.emplace_back(start, static_cast<size_t>(spot - start));
+      start = nullptr;
+    } else if (!start) {
+      start = spot;
+    }
+    spot += length;
   }
+  if (start) words.emplace_back(start, static_cast<size_t>(last - start));
+  return words;
+}
+
+/**
+ * Split a string into a list of views delimited by the given delimiter.
+ * Unlike split, no tokens are copied: each view refers into items.
+ * THROWS: std::out_of_range if a string delimiter is empty.
+ */
+template <typename Delim>
+std::vector<std::string_view> split_view(std::string_view items,
+                                         const Delim &delim) {
+  std::vector<std::string_view> tokens;
+  split_into(items, delim, tokens);
   return tokens;
 }
 
-template <>
-std::vector<std::string> split<std::string, std::string>(
-    const std::string &items, const std::string &delim) {
-  if (delim.empty()) throw std::out_of_range("Delimiter cannot be empty.");
-  if (delim.size() == 1) return split<std::string, char>(items, delim.front());
-  std::vector<size_t> positions;
-  for (auto pos = items.find(delim, 0); pos != std::string::npos;
-       pos = items.find(delim, pos + 1)) {
-    positions.emplace_back(pos);
-  }
-  std::vector<std::string> tokens;
-  // Upper bound on number of tokens.
-  tokens.reserve(positions.size() + 1);
-  // Skip ranges { [ pos, pos + delim.size() ) : pos in positions }
-  for (size_t base = 0, index = 0; index < positions.size(); ++index) {
-    auto pos = positions[index];
-    if (base != pos) tokens.emplace_back(items.substr(base, pos - base));
-    base = pos + delim.size();
+namespace detail {
+
+/**
+ * A sequence such as std::vector, std::deque or std::list with its
+ * allocator replaced by a std::pmr::polymorphic_allocator.
+ */
+template <typename Container>
+struct pmr_sequence;
+
+template <template <typename...> class Sequence, typename T, typename Alloc>
+struct pmr_sequence<Sequence<T, Alloc>> {
+  using type = Sequence<T, std::pmr::polymorphic_allocator<T>>;
+};
+
+/**
+ * The same kind of container as Container, but allocating from a
+ * std::pmr::memory_resource. Strings are matched on their own, since
+ * their extra traits parameter would otherwise pass for a sequence.
+ */
+template <typename Container>
+struct pmr_rebind : pmr_sequence<Container> {};
+
+template <typename Char, typename Traits, typename Alloc>
+struct pmr_rebind<std::basic_string<Char, Traits, Alloc>> {
+  using type = std::pmr::basic_string<Char, Traits>;
+};
+
+template <typename Container>
+using pmr_rebind_t = typename pmr_rebind<Container>::type;
+
+}  // namespace detail
+
+/**
+ * Split, allocating the list and every token from resource. Pointing
+ * resource at a std::pmr::monotonic_buffer_resource lets all of the
+ * tokens be released at once along with the buffer.
+ * REQUIRES: resource outlives the tokens.
+ * THROWS: std::out_of_range if a string delimiter is empty.
+ */
+template <typename Container, typename T>
+std::pmr::vector<detail::pmr_rebind_t<Container>> split(
+    const Container &items, const T &delim,
+    std::pmr::memory_resource *resource) {
+  instrument_probe probe(instrumented::split);
+  probe.add_bytes(std::size(items) * sizeof(*std::begin(items)));
+  std::pmr::vector<detail::pmr_rebind_t<Container>> tokens(resource);
+  if constexpr (std::is_convertible_v<const Container &, std::string_view>) {
+    // Tokens are found by split_range and copied straight into resource.
+    if constexpr (std::is_same_v<T, char>) {
+      for (auto token : split_range<char>(items, delim)) {
+        tokens.emplace_back(token);
+      }
+    } else {
+      for (auto token : split_range<std::string_view>(items, delim)) {
+        tokens.emplace_back(token);
+      }
+    }
+  } else {
+    for (auto iter = items.begin(); iter != items.end();) {
+      auto spot = std::find(iter, items.end(), delim);
+      if (iter != spot) tokens.emplace_back(iter, spot);
+      iter = (spot == items.end()) ? items.end() : std::next(spot);
+    }
   }
   return tokens;
 }
 
 /**
- * Join a range of items with a separator.
+ * Split into views, allocating the list of views from resource.
+ * REQUIRES: resource outlives the list.
+ * THROWS: std::out_of_range if a string delimiter is empty.
+ */
+template <typename Delim>
+std::pmr::vector<std::string_view> split_view(
+    std::string_view items, const Delim &delim,
+    std::pmr::memory_resource *resource) {
+  std::pmr::vector<std::string_view> tokens(resource);
+  split_into(items, delim, tokens);
+  return tokens;
+}
+
+namespace detail {
+
+/**
+ * Whether T can be joined by copying its characters, as std::string,
+ * std::string_view, string literals and single chars can.
+ */
+template <typename T>
+constexpr bool is_string_like_v =
+    std::is_convertible_v<const T &, std::string_view> ||
+    std::is_same_v<T, char>;
+
+/**
+ * REQUIRES: is_string_like_v<T>.
+ * The characters of a string-like item.
+ */
+template <typename T>
+inline std::string_view as_view(const T &item) {
+  if constexpr (std::is_same_v<T, char>) {
+    return std::string_view(&item, 1);
+  } else {
+    return std::string_view(item);
+  }
+}
+
+}  // namespace detail
+
+/**
+ * REQUIRES: items and sep are string-like.
+ * Append a range of items joined with a separator to out. For multi-pass
+ * ranges, the joined length is computed first so out grows only once.
+ * Reusing out across calls avoids allocating at all, and out may use any
+ * allocator, such as a std::pmr::string.
+ */
+template <typename Iter, typename T, typename Alloc>
+void join_into(Iter begin, Iter end, const T &sep,
+               std::basic_string<char, std::char_traits<char>, Alloc> &out) {
+  using item_type = typename std::iterator_traits<Iter>::value_type;
+  static_assert(detail::is_string_like_v<item_type> &&
+                detail::is_string_like_v<T>);
+  if (begin == end) return;
+  const auto separator = detail::as_view(sep);
+  using category = typename std::iterator_traits<Iter>::iterator_category;
+  if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+    size_t length = 0;
+    size_t count = 0;
+    for (auto iter = begin; iter != end; ++iter, ++count) {
+      length += detail::as_view(*iter).size();
+    }
+    out.reserve(out.size() + length + (count - 1) * separator.size());
+  }
+  out.append(detail::as_view(*begin));
+  for (++begin; begin != end; ++begin) {
+    out.append(separator);
+    out.append(detail::as_view(*begin));
+  }
+}
+
+/**
+ * REQUIRES: items and sep are string-like.
+ * Write the characters of a range of items joined with a separator to
+ * an output iterator. Returns the iterator past the last character.
+ */
+template <typename Iter, typename T, typename OutputIter>
+OutputIter join_into(Iter begin, Iter end, const T &sep, OutputIter out) {
+  using item_type = typename std::iterator_traits<Iter>::value_type;
+  static_assert(detail::is_string_like_v<item_type> &&
+                detail::is_string_like_v<T>);
+  if (begin == end) return out;
+  const auto separator = detail::as_view(sep);
+  const auto first = detail::as_view(*begin);
+  out = std::copy(first.begin(), first.end(), out);
+  for (++begin; begin != end; ++begin) {
+    const auto item = detail::as_view(*begin);
+    out = std::copy(separator.begin(), separator.end(), out);
+    out = std::copy(item.begin(), item.end(), out);
+  }
+  return out;
+}
+
+/**
+ * Join a range of items with a separator. String-like items are joined
+ * into a std::string allocated once. An empty range gives an empty item.
  */
 template <typename Iter, typename T>
 auto join(Iter begin, Iter end, T sep) {
-  auto value = *begin;
-  for (auto iter = std::next(begin); iter != end; ++iter) {
-    value += sep;
-    value += *iter;
+  instrument_probe probe(instrumented::join);
+  using item_type = typename std::iterator_traits<Iter>::value_type;
+  if constexpr (detail::is_string_like_v<item_type> &&
+                detail::is_string_like_v<T>) {
+    std::string value;
+    join_into(begin, end, sep, value);
+    probe.add_bytes(value.size());
+    return value;
+  } else {
+    if (begin == end) return item_type();
+    item_type value = *begin;
+    for (auto iter = std::next(begin); iter != end; ++iter) {
+      value += sep;
+      value += *iter;
+    }
+    return value;
   }
+}
+
+/**
+ * REQUIRES: items and sep are string-like.
+ * Join a range of items with a separator into a string allocated
+ * once from resource.
+ * REQUIRES: resource outlives the result.
+ */
+template <typename Iter, typename T>
+std::pmr::string join(Iter begin, Iter end, const T &sep,
+                      std::pmr::memory_resource *resource) {
+  instrument_probe probe(instrumented::join);
+  std::pmr::string value(resource);
+  join_into(begin, end, sep, value);
+  probe.add_bytes(value.size());
   return value;
 }
 
+namespace detail {
+
 /**
- * Python style container slicing that follows usual Python semantics.
- * REQUIRES: Container has bi-directional iteration and range construction.
+ * A slice resolved against a container: count items starting at
+ * index first, each step apart.
+ */
+struct slice_bounds {
+  ptrdiff_t first;
+  ptrdiff_t step;
+  size_t count;
+};
+
+/**
+ * Resolves Python slice parameters against a container of the given
+ * size. Negative indices count from the end, and the defaults depend
+ * on the sign of step, just as in Python.
  * THROWS: std::out_of_range for start, stop, and step parameters.
  */
-template <typename Container>
-Container slice(const Container &items,
-                std::optional<ptrdiff_t> start = std::nullopt,
-                std::optional<ptrdiff_t> stop = std::nullopt,
-                std::optional<ptrdiff_t> step = std::nullopt) {
+inline slice_bounds resolve_slice(size_t size, std::optional<ptrdiff_t> start,
+                                  std::optional<ptrdiff_t> stop,
+                                  std::optional<ptrdiff_t> step) {
   // Default step value is 1.
   const auto resolved_step = step.value_or(1);
   if (resolved_step == 0) throw std::out_of_range("Step must be non-zero.");
 
-  // Default start value depends on sign of step.
-  const auto resolved_start =
-      resolved_step > 0 ? start.value_or(0) : start.value_or(items.size() - 1);
-  // Valid if step is positive. Else should be one before begin.
-  const auto resolved_stop =
-      stop.value_or(static_cast<ptrdiff_t>(items.size()));
-
   // Check that start and stop are within bounds.
-  auto absolute = [](auto num) { return num >= 0 ? num : -num; };
-  if (static_cast<size_t>(absolute(resolved_start)) > items.size()) {
+  const auto length = static_cast<ptrdiff_t>(size);
+  auto in_bounds = [length](auto index) {
+    return !index.has_value() || (-length <= *index && *index <= length);
+  };
+  if (!in_bounds(start)) {
     throw std::out_of_range("Start parameter out of range.");
   }
-  if (static_cast<size_t>(absolute(resolved_stop)) > items.size()) {
+  if (!in_bounds(stop)) {
     throw std::out_of_range("Stop parameter out of range.");
   }
 
-  // Convert indices to iterators.
-  auto signed_iter = [&items](auto index) {
-    return index >= 0 ? std::next(items.begin(), index)
-                      : std::prev(items.end(), -index);
+  // Count negative indices from the end.
+  auto absolute = [length](ptrdiff_t index) {
+    return index < 0 ? index + length : index;
   };
-  const auto b_iter = signed_iter(resolved_start);
-  const auto e_iter = signed_iter(resolved_stop);
-
-  // Check if iter is still within bounds.
-  auto bound_check = [&items, &stop, resolved_step, &e_iter](const auto &iter) {
-    // If this is the case, the e_iter is valid.
-    if (resolved_step > 0) {
-      return iter < e_iter;
-    }
-    // Otherwise, we need to see if stop was given.
-    if (stop.has_value()) {
-      return (resolved_step > 0) ? (iter < e_iter) : (iter > e_iter);
-    } else {
-      return iter >= items.begin();
+  if (resolved_step > 0) {
+    const auto first = start ? absolute(*start) : 0;
+    const auto last = stop ? absolute(*stop) : length;
+    const auto count =
+        first < last ? (last - first - 1) / resolved_step + 1 : 0;
+    return {first, resolved_step, static_cast<size_t>(count)};
+  }
+  // Walking backward, the first item is at most the last index, and the
+  // default stop is one before the beginning.
+  const auto first =
+      start ? std::min(absolute(*start), length - 1) : length - 1;
+  const auto last = stop ? std::min(absolute(*stop), length - 1) : -1;
+  const auto count =
+      first > last ? (first - last - 1) / -resolved_step + 1 : 0;
+  return {first, resolved_step, static_cast<size_t>(count)};
+}
+
+}  // namespace detail
+
+/**
+ * Lazy Python style slice of a container. Items are read in place as
+ * the view is traversed, so nothing is copied. Const containers are
+ * read-only, while non-const containers can be written through the
+ * view. The iterator has the same category as the container's.
+ * REQUIRES: C has bi-directional iteration.
+ * REQUIRES: items outlives the view and its iterators.
+ * THROWS: std::out_of_range for start, stop, and step parameters.
+ */
+template <typename C>
+class slice_view {
+ private:
+  using iter_type = decltype(std::begin(std::declval<C &>()));
+  using traits = std::iterator_traits<iter_type>;
+
+  const detail::slice_bounds m_bounds;
+
+  /**
+   * Points at the first item, or at begin if the slice is empty.
+   */
+  const iter_type m_first;
+
+ public:
+  slice_view() = delete;
+
+  /**
+   * Slice view should be passed the container and slice parameters.
+   */
+  explicit slice_view(C &, std::optional<ptrdiff_t> = std::nullopt,
+                      std::optional<ptrdiff_t> = std::nullopt,
+                      std::optional<ptrdiff_t> = std::nullopt);
+
+  // Declare iterators of the container's category.
+  class iterator {
+    friend class slice_view;
+
+   private:
+    /**
+     * Points at item m_index, or at the last item once past it, so that
+     * the container's iterator never steps outside the container.
+     */
+    iter_type m_iter;
+    ptrdiff_t m_step;
+    size_t m_index;
+    size_t m_count;
+
+    /**
+     * Constructor that gives parameters.
+     */
+    iterator(iter_type, ptrdiff_t, size_t, size_t);
+
+    /**
+     * Offset of m_iter from the first item, in steps.
+     */
+    ptrdiff_t position() const;
+
+   public:
+    using iterator_category = typename traits::iterator_category;
+    using value_type = typename traits::value_type;
+    using difference_type = ptrdiff_t;
+    using pointer = typename traits::pointer;
+    using reference = typename traits::reference;
+
+    iterator() = delete;
+
+    // Increment operator.
+
+    iterator &operator++();
+    iterator operator++(int);
+
+    // Decrement operator.
+
+    iterator &operator--();
+    iterator operator--(int);
+
+    // Random access operators. REQUIRES: random access container.
+
+    iterator &operator+=(ptrdiff_t);
+    iterator &operator-=(ptrdiff_t);
+    iterator operator+(ptrdiff_t) const;
+    iterator operator-(ptrdiff_t) const;
+    ptrdiff_t operator-(const iterator &) const;
+    reference operator[](ptrdiff_t) const;
+
+    friend iterator operator+(ptrdiff_t n, const iterator &it) {
+      return it + n;
     }
+
+    // Dereference operator.
+
+    reference operator*() const;
+
+    // These iterators do not support arrow operators.
+
+    // Comparison operators.
+
+    bool operator==(const iterator &) const;
+    bool operator!=(const iterator &) const;
+    bool operator<(const iterator &) const;
+    bool operator>(const iterator &) const;
+    bool operator<=(const iterator &) const;
+    bool operator>=(const iterator &) const;
   };
 
-  std::vector<typename Container::value_type> history;
-  for (auto it = b_iter; bound_check(it); std::advance(it, resolved_step)) {
-    history.emplace_back(*it);
+  /**
+   * An iterator to the first item in the slice.
+   */
+  iterator begin() const;
+
+  /**
+   * An iterator to one past the last item in the slice.
+   */
+  iterator end() const;
+
+  /**
+   * The number of items in the slice.
+   */
+  size_t size() const;
+
+  /**
+   * The resolved step between consecutive items.
+   */
+  ptrdiff_t step() const;
+};
+
+template <typename C>
+inline slice_view<C>::slice_view(C &items, std::optional<ptrdiff_t> start,
+                                 std::optional<ptrdiff_t> stop,
+                                 std::optional<ptrdiff_t> step)
+    : m_bounds(detail::resolve_slice(std::size(items), start, stop, step)),
+      m_first(
+          std::next(std::begin(items), m_bounds.count ? m_bounds.first : 0)) {}
+
+template <typename C>
+inline typename slice_view<C>::iterator slice_view<C>::begin() const {
+  return iterator(m_first, m_bounds.step, 0, m_bounds.count);
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator slice_view<C>::end() const {
+  auto last = m_first;
+  if (m_bounds.count) {
+    const auto offset = static_cast<ptrdiff_t>(m_bounds.count - 1);
+    std::advance(last, offset * m_bounds.step);
+  }
+  return iterator(last, m_bounds.step, m_bounds.count, m_bounds.count);
+}
+
+template <typename C>
+inline size_t slice_view<C>::size() const {
+  return m_bounds.count;
+}
+
+template <typename C>
+inline ptrdiff_t slice_view<C>::step() const {
+  return m_bounds.step;
+}
+
+template <typename C>
+inline slice_view<C>::iterator::iterator(iter_type iter_in, ptrdiff_t step_in,
+                                         size_t index_in, size_t count_in)
+    : m_iter(iter_in), m_step(step_in), m_index(index_in), m_count(count_in) {}
+
+template <typename C>
+inline ptrdiff_t slice_view<C>::iterator::position() const {
+  return static_cast<ptrdiff_t>(m_index < m_count ? m_index : m_count - 1);
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator &slice_view<C>::iterator::operator++() {
+  if (++m_index < m_count) std::advance(m_iter, m_step);
+  return *this;
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator slice_view<C>::iterator::operator++(
+    int) {
+  auto temp(*this);
+  this->operator++();
+  return temp;
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator &slice_view<C>::iterator::operator--() {
+  if (m_index-- < m_count) std::advance(m_iter, -m_step);
+  return *this;
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator slice_view<C>::iterator::operator--(
+    int) {
+  auto temp(*this);
+  this->operator--();
+  return temp;
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator &slice_view<C>::iterator::operator+=(
+    ptrdiff_t n) {
+  const auto before = position();
+  m_index = static_cast<size_t>(static_cast<ptrdiff_t>(m_index) + n);
+  m_iter += (position() - before) * m_step;
+  return *this;
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator &slice_view<C>::iterator::operator-=(
+    ptrdiff_t n) {
+  return this->operator+=(-n);
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator slice_view<C>::iterator::operator+(
+    ptrdiff_t n) const {
+  auto temp(*this);
+  return temp += n;
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator slice_view<C>::iterator::operator-(
+    ptrdiff_t n) const {
+  auto temp(*this);
+  return temp -= n;
+}
+
+template <typename C>
+inline ptrdiff_t slice_view<C>::iterator::operator-(
+    const typename slice_view<C>::iterator &other) const {
+  return static_cast<ptrdiff_t>(m_index) -
+         static_cast<ptrdiff_t>(other.m_index);
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator::reference
+    slice_view<C>::iterator::operator[](ptrdiff_t n) const {
+  return *(*this + n);
+}
+
+template <typename C>
+inline typename slice_view<C>::iterator::reference
+    slice_view<C>::iterator::operator*() const {
+  return *m_iter;
+}
+
+template <typename C>
+inline bool slice_view<C>::iterator::operator==(
+    const typename slice_view<C>::iterator &other) const {
+  return m_index == other.m_index;
+}
+
+template <typename C>
+inline bool slice_view<C>::iterator::operator!=(
+    const typename slice_view<C>::iterator &other) const {
+  return m_index != other.m_index;
+}
+
+template <typename C>
+inline bool slice_view<C>::iterator::operator<(
+    const typename slice_view<C>::iterator &other) const {
+  return m_index < other.m_index;
+}
+
+template <typename C>
+inline bool slice_view<C>::iterator::operator>(
+    const typename slice_view<C>::iterator &other) const {
+  return other < *this;
+}
+
+template <typename C>
+inline bool slice_view<C>::iterator::operator<=(
+    const typename slice_view<C>::iterator &other) const {
+  return !(other < *this);
+}
+
+template <typename C>
+inline bool slice_view<C>::iterator::operator>=(
+    const typename slice_view<C>::iterator &other) const {
+  return !(*this < other);
+}
+
+namespace detail {
+
+/**
+ * Python style slicing of items into a container of the given type.
+ * REQUIRES: Result has range construction.
+ * THROWS: std::out_of_range for start, stop, and step parameters.
+ */
+template <typename Result, typename Container>
+Result slice_as(const Container &items, std::optional<ptrdiff_t> start,
+                std::optional<ptrdiff_t> stop, std::optional<ptrdiff_t> step) {
+  instrument_probe probe(instrumented::slice);
+  const auto bounds = detail::resolve_slice(items.size(), start, stop, step);
+  probe.add_bytes(bounds.count * sizeof(*items.begin()));
+  if (bounds.step == 1) {
+    // Contiguous selection, so construct from the container's iterators.
+    const auto first = std::next(items.begin(), bounds.first);
+    return Result(first, std::next(first, bounds.count));
+  }
+  const slice_view view(items, start, stop, step);
+  return Result(view.begin(), view.end());
+}
+
+}  // namespace detail
+
+/**
+ * Python style container slicing that follows usual Python semantics.
+ * The result is built in one pass straight from the container.
+ * REQUIRES: Container has bi-directional iteration and range construction.
+ * THROWS: std::out_of_range for start, stop, and step parameters.
+ */
+template <typename Container>
+Container slice(const Container &items,
+                std::optional<ptrdiff_t> start = std::nullopt,
+                std::optional<ptrdiff_t> stop = std::nullopt,
+                std::optional<ptrdiff_t> step = std::nullopt) {
+  return detail::slice_as<Container>(items, start, stop, step);
+}
+
+/**
+ * Python style slicing into a small_vector that keeps the first N items
+ * inline, so short slices never allocate: slice<8>(items, 2, 10).
+ * REQUIRES: Container has bi-directional iteration.
+ * THROWS: std::out_of_range for start, stop, and step parameters.
+ */
+template <size_t N, typename Container>
+small_vector<typename Container::value_type, N> slice(
+    const Container &items, std::optional<ptrdiff_t> start = std::nullopt,
+    std::optional<ptrdiff_t> stop = std::nullopt,
+    std::optional<ptrdiff_t> step = std::nullopt) {
+  return detail::slice_as<small_vector<typename Container::value_type, N>>(
+      items, start, stop, step);
+}
+
+/**
+ * Python style container slicing, allocating the result from resource.
+ * The result is the container's std::pmr counterpart, so slicing a
+ * std::vector<T> gives a std::pmr::vector<T>. This is not an overload
+ * of slice, since a literal 0 start would convert to a null resource.
+ * REQUIRES: Container has bi-directional iteration and range construction.
+ * REQUIRES: resource outlives the result.
+ * THROWS: std::out_of_range for start, stop, and step parameters.
+ */
+template <typename Container>
+detail::pmr_rebind_t<Container> slice_pmr(
+    const Container &items, std::pmr::memory_resource *resource,
+    std::optional<ptrdiff_t> start = std::nullopt,
+    std::optional<ptrdiff_t> stop = std::nullopt,
+    std::optional<ptrdiff_t> step = std::nullopt) {
+  using result = detail::pmr_rebind_t<Container>;
+  instrument_probe probe(instrumented::slice);
+  const typename result::allocator_type allocator(resource);
+  const auto bounds = detail::resolve_slice(items.size(), start, stop, step);
+  probe.add_bytes(bounds.count * sizeof(*items.begin()));
+  if (bounds.step == 1) {
+    const auto first = std::next(items.begin(), bounds.first);
+    return result(first, std::next(first, bounds.count), allocator);
   }
-  return Container(history.begin(), history.end());
+  const slice_view view(items, start, stop, step);
+  return result(view.begin(), view.end(), allocator);
 }
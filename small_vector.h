@@ -0,0 +1,481 @@
+/*
+Copyright 2020. Siwei Wang.
+
+A vector that keeps its first few items inline.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Templated vector that stores up to N items inside the object itself
+ * and only moves them to the heap once it outgrows them. Short lists,
+ * such as the tokens of a typical split, never allocate at all.
+ * Iterators are plain pointers, and like std::vector's, they are
+ * invalidated when the vector grows.
+ * REQUIRES: N > 0, and T is move or copy constructible.
+ */
+template <typename T, size_t N>
+class small_vector {
+  static_assert(N > 0, "Inline capacity must be positive.");
+
+ private:
+  /**
+   * Points at m_inline until the items move to the heap.
+   */
+  T *m_data;
+  size_t m_size;
+  size_t m_capacity;
+  alignas(T) unsigned char m_inline[N * sizeof(T)];
+
+  T *inline_data();
+
+  /**
+   * Moves or copies the items into a new block. If this throws, the
+   * block is left without any of them.
+   */
+  void relocate(T *);
+
+  /**
+   * Destroys the old items and switches over to a relocated block.
+   */
+  void adopt(T *, size_t) noexcept;
+
+  /**
+   * Destroys every item and returns to the inline storage.
+   */
+  void release();
+
+  /**
+   * REQUIRES: the vector is empty.
+   * Takes the items of other, stealing its heap block if it has one.
+   */
+  void take(small_vector &&);
+
+ public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  /**
+   * The number of items stored without allocating.
+   */
+  static constexpr size_t inline_capacity = N;
+
+  small_vector();
+
+  /**
+   * A vector of count copies of value.
+   */
+  explicit small_vector(size_t count, const T &value = T());
+
+  /**
+   * A vector of the items in [first, last). Forward ranges are
+   * measured first, so the vector allocates at most once.
+   */
+  template <typename Iter,
+            typename = typename std::iterator_traits<Iter>::iterator_category>
+  small_vector(Iter first, Iter last);
+
+  small_vector(std::initializer_list<T>);
+
+  small_vector(const small_vector &);
+  small_vector(small_vector &&) noexcept(
+      std::is_nothrow_move_constructible_v<T>);
+
+  small_vector &operator=(const small_vector &);
+  small_vector &operator=(small_vector &&) noexcept(
+      std::is_nothrow_move_constructible_v<T>);
+
+  ~small_vector();
+
+  // Iteration over the items.
+
+  iterator begin();
+  iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  /**
+   * Pointer to the first item.
+   */
+  T *data();
+  const T *data() const;
+
+  /**
+   * The number of items in the vector.
+   */
+  size_t size() const;
+
+  /**
+   * Whether the vector has no items.
+   */
+  bool empty() const;
+
+  /**
+   * The number of items that fit before the vector grows again.
+   */
+  size_t capacity() const;
+
+  /**
+   * Whether the items are still stored inside the object.
+   */
+  bool is_inline() const;
+
+  /**
+   * The item at the given position. REQUIRES: index < size().
+   */
+  T &operator[](size_t);
+  const T &operator[](size_t) const;
+
+  /**
+   * The item at the given position.
+   * THROWS: std::out_of_range if index >= size().
+   */
+  T &at(size_t);
+  const T &at(size_t) const;
+
+  /**
+   * The first and last items. REQUIRES: !empty().
+   */
+  T &front();
+  const T &front() const;
+  T &back();
+  const T &back() const;
+
+  /**
+   * Makes room for at least capacity items.
+   */
+  void reserve(size_t capacity);
+
+  /**
+   * Destroys every item, but keeps the capacity.
+   */
+  void clear();
+
+  /**
+   * Appends an item constructed from args, growing if full.
+   * Returns a reference to the new item.
+   */
+  template <typename... Args>
+  T &emplace_back(Args &&...args);
+
+  void push_back(const T &);
+  void push_back(T &&);
+
+  /**
+   * Destroys the last item. REQUIRES: !empty().
+   */
+  void pop_back();
+};
+
+/**
+ * Whether two vectors hold equal items in the same order.
+ */
+template <typename T, size_t N, size_t M>
+bool operator==(const small_vector<T, N> &, const small_vector<T, M> &);
+
+template <typename T, size_t N, size_t M>
+bool operator!=(const small_vector<T, N> &, const small_vector<T, M> &);
+
+/* --- TEMPLATE IMPLEMENTATION --- */
+
+template <typename T, size_t N>
+inline T *small_vector<T, N>::inline_data() {
+  return reinterpret_cast<T *>(m_inline);
+}
+
+template <typename T, size_t N>
+inline void small_vector<T, N>::relocate(T *block) {
+  // Copying keeps the old items intact should a copy throw.
+  if constexpr (std::is_nothrow_move_constructible_v<T> ||
+                !std::is_copy_constructible_v<T>) {
+    std::uninitialized_move(begin(), end(), block);
+  } else {
+    std::uninitialized_copy(begin(), end(), block);
+  }
+}
+
+template <typename T, size_t N>
+inline void small_vector<T, N>::adopt(T *block, size_t capacity) noexcept {
+  std::destroy(begin(), end());
+  if (!is_inline()) std::allocator<T>().deallocate(m_data, m_capacity);
+  m_data = block;
+  m_capacity = capacity;
+}
+
+template <typename T, size_t N>
+inline void small_vector<T, N>::release() {
+  clear();
+  if (!is_inline()) {
+    std::allocator<T>().deallocate(m_data, m_capacity);
+    m_data = inline_data();
+    m_capacity = N;
+  }
+}
+
+template <typename T, size_t N>
+inline void small_vector<T, N>::take(small_vector &&other) {
+  if (other.is_inline()) {
+    reserve(other.m_size);
+    std::uninitialized_move(other.begin(), other.end(), m_data);
+    m_size = other.m_size;
+    other.clear();
+  } else {
+    release();
+    m_data = other.m_data;
+    m_size = other.m_size;
+    m_capacity = other.m_capacity;
+    other.m_data = other.inline_data();
+    other.m_size = 0;
+    other.m_capacity = N;
+  }
+}
+
+template <typename T, size_t N>
+inline small_vector<T, N>::small_vector()
+    : m_data(inline_data()), m_size(0), m_capacity(N) {}
+
+template <typename T, size_t N>
+inline small_vector<T, N>::small_vector(size_t count, const T &value)
+    : small_vector() {
+  reserve(count);
+  std::uninitialized_fill_n(m_data, count, value);
+  m_size = count;
+}
+
+template <typename T, size_t N>
+template <typename Iter, typename>
+inline small_vector<T, N>::small_vector(Iter first, Iter last)
+    : small_vector() {
+  using category = typename std::iterator_traits<Iter>::iterator_category;
+  if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+    const auto count = static_cast<size_t>(std::distance(first, last));
+    reserve(count);
+    std::uninitialized_copy(first, last, m_data);
+    m_size = count;
+  } else {
+    for (; first != last; ++first) emplace_back(*first);
+  }
+}
+
+template <typename T, size_t N>
+inline small_vector<T, N>::small_vector(std::initializer_list<T> items)
+    : small_vector(items.begin(), items.end()) {}
+
+template <typename T, size_t N>
+inline small_vector<T, N>::small_vector(const small_vector &other)
+    : small_vector(other.begin(), other.end()) {}
+
+template <typename T, size_t N>
+inline small_vector<T, N>::small_vector(small_vector &&other) noexcept(
+    std::is_nothrow_move_constructible_v<T>)
+    : small_vector() {
+  take(std::move(other));
+}
+
+template <typename T, size_t N>
+inline small_vector<T, N> &small_vector<T, N>::operator=(
+    const small_vector &other) {
+  if (this != &other) {
+    clear();
+    reserve(other.m_size);
+    std::uninitialized_copy(other.begin(), other.end(), m_data);
+    m_size = other.m_size;
+  }
+  return *this;
+}
+
+template <typename T, size_t N>
+inline small_vector<T, N> &small_vector<T, N>::operator=(
+    small_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+  if (this != &other) {
+    clear();
+    take(std::move(other));
+  }
+  return *this;
+}
+
+template <typename T, size_t N>
+inline small_vector<T, N>::~small_vector() {
+  release();
+}
+
+template <typename T, size_t N>
+inline T *small_vector<T, N>::begin() {
+  return m_data;
+}
+
+template <typename T, size_t N>
+inline T *small_vector<T, N>::end() {
+  return m_data + m_size;
+}
+
+template <typename T, size_t N>
+inline const T *small_vector<T, N>::begin() const {
+  return m_data;
+}
+
+template <typename T, size_t N>
+inline const T *small_vector<T, N>::end() const {
+  return m_data + m_size;
+}
+
+template <typename T, size_t N>
+inline T *small_vector<T, N>::data() {
+  return m_data;
+}
+
+template <typename T, size_t N>
+inline const T *small_vector<T, N>::data() const {
+  return m_data;
+}
+
+template <typename T, size_t N>
+inline size_t small_vector<T, N>::size() const {
+  return m_size;
+}
+
+template <typename T, size_t N>
+inline bool small_vector<T, N>::empty() const {
+  return m_size == 0;
+}
+
+template <typename T, size_t N>
+inline size_t small_vector<T, N>::capacity() const {
+  return m_capacity;
+}
+
+template <typename T, size_t N>
+inline bool small_vector<T, N>::is_inline() const {
+  return m_data == reinterpret_cast<const T *>(m_inline);
+}
+
+template <typename T, size_t N>
+inline T &small_vector<T, N>::operator[](size_t index) {
+  return m_data[index];
+}
+
+template <typename T, size_t N>
+inline const T &small_vector<T, N>::operator[](size_t index) const {
+  return m_data[index];
+}
+
+template <typename T, size_t N>
+inline T &small_vector<T, N>::at(size_t index) {
+  if (index >= m_size) throw std::out_of_range("Index out of range.");
+  return m_data[index];
+}
+
+template <typename T, size_t N>
+inline const T &small_vector<T, N>::at(size_t index) const {
+  if (index >= m_size) throw std::out_of_range("Index out of range.");
+  return m_data[index];
+}
+
+template <typename T, size_t N>
+inline T &small_vector<T, N>::front() {
+  return m_data[0];
+}
+
+template <typename T, size_t N>
+inline const T &small_vector<T, N>::front() const {
+  return m_data[0];
+}
+
+template <typename T, size_t N>
+inline T &small_vector<T, N>::back() {
+  return m_data[m_size - 1];
+}
+
+template <typename T, size_t N>
+inline const T &small_vector<T, N>::back() const {
+  return m_data[m_size - 1];
+}
+
+template <typename T, size_t N>
+inline void small_vector<T, N>::reserve(size_t capacity) {
+  if (capacity <= m_capacity) return;
+  const auto block = std::allocator<T>().allocate(capacity);
+  try {
+    relocate(block);
+  } catch (...) {
+    std::allocator<T>().deallocate(block, capacity);
+    throw;
+  }
+  adopt(block, capacity);
+}
+
+template <typename T, size_t N>
+inline void small_vector<T, N>::clear() {
+  std::destroy(begin(), end());
+  m_size = 0;
+}
+
+template <typename T, size_t N>
+template <typename... Args>
+inline T &small_vector<T, N>::emplace_back(Args &&...args) {
+  if (m_size == m_capacity) {
+    // Construct the new item before moving the others, since args
+    // may refer to one of them.
+    const auto capacity = 2 * m_capacity;
+    const auto block = std::allocator<T>().allocate(capacity);
+    try {
+      ::new (static_cast<void *>(block + m_size))
+          T(std::forward<Args>(args)...);
+      try {
+        relocate(block);
+      } catch (...) {
+        std::destroy_at(block + m_size);
+        throw;
+      }
+    } catch (...) {
+      std::allocator<T>().deallocate(block, capacity);
+      throw;
+    }
+    adopt(block, capacity);
+  } else {
+    ::new (static_cast<void *>(m_data + m_size)) T(std::forward<Args>(args)...);
+  }
+  return m_data[m_size++];
+}
+
+template <typename T, size_t N>
+inline void small_vector<T, N>::push_back(const T &item) {
+  emplace_back(item);
+}
+
+template <typename T, size_t N>
+inline void small_vector<T, N>::push_back(T &&item) {
+  emplace_back(std::move(item));
+}
+
+template <typename T, size_t N>
+inline void small_vector<T, N>::pop_back() {
+  std::destroy_at(m_data + --m_size);
+}
+
+template <typename T, size_t N, size_t M>
+inline bool operator==(const small_vector<T, N> &a,
+                       const small_vector<T, M> &b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+template <typename T, size_t N, size_t M>
+inline bool operator!=(const small_vector<T, N> &a,
+                       const small_vector<T, M> &b) {
+  return !(a == b);
+}
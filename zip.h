@@ -1,52 +1,130 @@
 /*
 Copyright 2020. Siwei Wang.
 
-Python-like parallel iteration for two containers.
+Python-like parallel iteration for any number of containers.
 */
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <iterator>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
+namespace detail {
+
+/**
+ * Bundles one item from each zipped container. Two containers
+ * give a std::pair, while any other number gives a std::tuple.
+ */
+template <typename... Ts>
+struct zip_bundle {
+  using type = std::tuple<Ts...>;
+};
+
+template <typename T1, typename T2>
+struct zip_bundle<T1, T2> {
+  using type = std::pair<T1, T2>;
+};
+
+}  // namespace detail
+
 /**
- * Templated zipper class for read-only parallel iteration.
- * REQUIRES: C1 and C2 are forward_iterable.
+ * Templated zipper class for parallel iteration. Dereferencing yields a
+ * pair (for two containers) or tuple of references into the containers,
+ * so nothing is copied and structured bindings can name each item.
+ * Const containers are read-only, while non-const containers can be
+ * written through the zip. Iteration stops at the end of the shortest.
+ * REQUIRES: Cs are forward_iterable.
  */
-template <typename C1, typename C2>
+template <typename... Cs>
 class zip {
+  static_assert(sizeof...(Cs) > 0, "Zip needs at least one container.");
+
  private:
-  const C1 &container_1;
-  const C2 &container_2;
+  std::tuple<Cs &...> containers;
+
+  using iterators = std::tuple<decltype(std::begin(std::declval<Cs &>()))...>;
+  using sentinels = std::tuple<decltype(std::end(std::declval<Cs &>()))...>;
+
+  static constexpr bool is_random_access =
+      (std::is_base_of_v<std::random_access_iterator_tag,
+                         typename std::iterator_traits<decltype(std::begin(
+                             std::declval<Cs &>()))>::iterator_category> &&
+       ...);
+
+  /**
+   * What the end compares against. With random access containers the
+   * shortest length is known up front, so the first container's
+   * iterator at that length is enough. Otherwise every end is kept.
+   */
+  using limit =
+      std::conditional_t<is_random_access, std::tuple_element_t<0, iterators>,
+                         sentinels>;
 
  public:
   zip() = delete;
 
   /**
-   * Zip should be passed the two containers to iterate over.
+   * Zip should be passed the containers to iterate over.
+   */
+  zip(Cs &...);
+
+  /**
+   * Marks the end of the zip. For random access containers this is
+   * where the first container stops, so reaching the end is a single
+   * comparison. Otherwise it holds the end of every container.
    */
-  zip(const C1 &, const C2 &);
+  class sentinel {
+    friend class zip;
+
+   private:
+    limit stop;
+
+    /**
+     * Constructor that gives parameters.
+     */
+    explicit sentinel(limit);
+
+   public:
+    sentinel() = delete;
+  };
 
   // Declare forward iterators.
-  class iterator
-      : public std::iterator<
-            std::forward_iterator_tag,
-            std::pair<typename C1::value_type, typename C2::value_type>,
-            ptrdiff_t,
-            const std::pair<typename C1::value_type, typename C2::value_type> *,
-            const std::pair<typename C1::value_type, typename C2::value_type>
-                &> {
+  class iterator {
     friend class zip;
 
    private:
-    typename C1::const_iterator c1_it;
-    typename C2::const_iterator c2_it;
+    iterators iters;
 
     /**
      * Constructor that gives parameters.
      */
-    explicit iterator(typename C1::const_iterator, typename C2::const_iterator);
+    explicit iterator(iterators);
+
+    // Helpers that expand over every container.
+
+    template <size_t... I>
+    void increment(std::index_sequence<I...>);
+
+    template <size_t... I>
+    auto dereference(std::index_sequence<I...>) const;
+
+    template <size_t... I>
+    bool exhausted(const sentinel &, std::index_sequence<I...>) const;
 
    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename detail::zip_bundle<
+        typename std::iterator_traits<decltype(
+            std::begin(std::declval<Cs &>()))>::value_type...>::type;
+    using difference_type = ptrdiff_t;
+    using pointer = void;
+    using reference = typename detail::zip_bundle<
+        typename std::iterator_traits<decltype(
+            std::begin(std::declval<Cs &>()))>::reference...>::type;
+
     iterator() = delete;
 
     // Increment operator.
@@ -56,86 +134,130 @@ class zip {
 
     // Dereference operator.
 
-    std::pair<typename C1::value_type, typename C2::value_type> operator*()
-        const;
+    reference operator*() const;
 
     // These iterators do not support arrow operators.
 
-    // Comparison operators.
+    // Comparison operators. Iterators from the same zip move in step,
+    // so comparing the first container's position is enough.
 
     bool operator==(const iterator &) const;
     bool operator!=(const iterator &) const;
+
+    // Comparison with the end. True once any container is exhausted.
+
+    bool operator==(const sentinel &) const;
+    bool operator!=(const sentinel &) const;
   };
 
   /**
-   * An iterator to the first pair.
+   * An iterator to the first bundle.
    */
   iterator begin() const;
 
   /**
-   * An iterator to one past the last pair.
+   * A sentinel that compares equal to an iterator once
+   * any of the containers has been exhausted.
    */
-  iterator end() const;
+  sentinel end() const;
 };
 
 /* --- TEMPLATE IMPLEMENTATION --- */
 
-template <typename C1, typename C2>
-inline zip<C1, C2>::zip(const C1 &c1, const C2 &c2)
-    : container_1(c1), container_2(c2) {}
+template <typename... Cs>
+inline zip<Cs...>::zip(Cs &... cs) : containers(cs...) {}
 
-template <typename C1, typename C2>
-inline typename zip<C1, C2>::iterator zip<C1, C2>::begin() const {
-  return iterator(container_1.cbegin(), container_2.cbegin());
+template <typename... Cs>
+inline typename zip<Cs...>::iterator zip<Cs...>::begin() const {
+  return iterator(std::apply(
+      [](auto &... cs) { return iterators(std::begin(cs)...); }, containers));
 }
 
-template <typename C1, typename C2>
-inline typename zip<C1, C2>::iterator zip<C1, C2>::end() const {
-  const auto sz_1 = container_1.size();
-  const auto sz_2 = container_2.size();
-  if (sz_1 < sz_2) {
-    const auto iter = std::next(container_2.cbegin(), sz_1);
-    return iterator(container_1.cend(), iter);
+template <typename... Cs>
+inline typename zip<Cs...>::sentinel zip<Cs...>::end() const {
+  if constexpr (is_random_access) {
+    const auto shortest = std::apply(
+        [](auto &... cs) {
+          return std::min({static_cast<ptrdiff_t>(std::end(cs) -
+                                                  std::begin(cs))...});
+        },
+        containers);
+    return sentinel(std::begin(std::get<0>(containers)) + shortest);
   } else {
-    const auto iter = std::next(container_1.cbegin(), sz_2);
-    return iterator(iter, container_2.cend());
+    return sentinel(std::apply(
+        [](auto &... cs) { return sentinels(std::end(cs)...); }, containers));
   }
 }
 
-template <typename C1, typename C2>
-inline zip<C1, C2>::iterator::iterator(typename C1::const_iterator it1,
-                                       typename C2::const_iterator it2)
-    : c1_it(it1), c2_it(it2) {}
+template <typename... Cs>
+inline zip<Cs...>::sentinel::sentinel(limit stop_in) : stop(stop_in) {}
+
+template <typename... Cs>
+inline zip<Cs...>::iterator::iterator(iterators iters_in) : iters(iters_in) {}
 
-template <typename C1, typename C2>
-inline typename zip<C1, C2>::iterator &zip<C1, C2>::iterator::operator++() {
-  ++c1_it;
-  ++c2_it;
+template <typename... Cs>
+template <size_t... I>
+inline void zip<Cs...>::iterator::increment(std::index_sequence<I...>) {
+  (++std::get<I>(iters), ...);
+}
+
+template <typename... Cs>
+template <size_t... I>
+inline auto zip<Cs...>::iterator::dereference(
+    std::index_sequence<I...>) const {
+  return reference(*std::get<I>(iters)...);
+}
+
+template <typename... Cs>
+template <size_t... I>
+inline bool zip<Cs...>::iterator::exhausted(const sentinel &last,
+                                            std::index_sequence<I...>) const {
+  if constexpr (is_random_access) {
+    return std::get<0>(iters) == last.stop;
+  } else {
+    return ((std::get<I>(iters) == std::get<I>(last.stop)) || ...);
+  }
+}
+
+template <typename... Cs>
+inline typename zip<Cs...>::iterator &zip<Cs...>::iterator::operator++() {
+  increment(std::index_sequence_for<Cs...>());
   return *this;
 }
 
-template <typename C1, typename C2>
-inline typename zip<C1, C2>::iterator zip<C1, C2>::iterator::operator++(int) {
+template <typename... Cs>
+inline typename zip<Cs...>::iterator zip<Cs...>::iterator::operator++(int) {
   auto temp(*this);
-  ++c1_it;
-  ++c2_it;
+  this->operator++();
   return temp;
 }
 
-template <typename C1, typename C2>
-inline std::pair<typename C1::value_type, typename C2::value_type>
-    zip<C1, C2>::iterator::operator*() const {
-  return std::make_pair(*c1_it, *c2_it);
+template <typename... Cs>
+inline typename zip<Cs...>::iterator::reference zip<Cs...>::iterator::
+operator*() const {
+  return dereference(std::index_sequence_for<Cs...>());
+}
+
+template <typename... Cs>
+inline bool zip<Cs...>::iterator::operator==(
+    const typename zip<Cs...>::iterator &other) const {
+  return std::get<0>(iters) == std::get<0>(other.iters);
+}
+
+template <typename... Cs>
+inline bool zip<Cs...>::iterator::operator!=(
+    const typename zip<Cs...>::iterator &other) const {
+  return std::get<0>(iters) != std::get<0>(other.iters);
 }
 
-template <typename C1, typename C2>
-inline bool zip<C1, C2>::iterator::operator==(
-    const typename zip<C1, C2>::iterator &other) const {
-  return c1_it == other.c1_it && c2_it == other.c2_it;
+template <typename... Cs>
+inline bool zip<Cs...>::iterator::operator==(
+    const typename zip<Cs...>::sentinel &stop) const {
+  return exhausted(stop, std::index_sequence_for<Cs...>());
 }
 
-template <typename C1, typename C2>
-inline bool zip<C1, C2>::iterator::operator!=(
-    const typename zip<C1, C2>::iterator &other) const {
-  return c1_it != other.c1_it || c2_it != other.c2_it;
+template <typename... Cs>
+inline bool zip<Cs...>::iterator::operator!=(
+    const typename zip<Cs...>::sentinel &stop) const {
+  return !exhausted(stop, std::index_sequence_for<Cs...>());
 }